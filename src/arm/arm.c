@@ -212,58 +212,9 @@ static inline void ARMStep(struct ARMCore* cpu) {
 	cpu->gprs[ARM_PC] += WORD_SIZE_ARM;
 
 	unsigned condition = opcode >> 28;
-	if (condition != 0xE) {
-		bool conditionMet = false;
-		switch (condition) {
-		case 0x0:
-			conditionMet = ARM_COND_EQ;
-			break;
-		case 0x1:
-			conditionMet = ARM_COND_NE;
-			break;
-		case 0x2:
-			conditionMet = ARM_COND_CS;
-			break;
-		case 0x3:
-			conditionMet = ARM_COND_CC;
-			break;
-		case 0x4:
-			conditionMet = ARM_COND_MI;
-			break;
-		case 0x5:
-			conditionMet = ARM_COND_PL;
-			break;
-		case 0x6:
-			conditionMet = ARM_COND_VS;
-			break;
-		case 0x7:
-			conditionMet = ARM_COND_VC;
-			break;
-		case 0x8:
-			conditionMet = ARM_COND_HI;
-			break;
-		case 0x9:
-			conditionMet = ARM_COND_LS;
-			break;
-		case 0xA:
-			conditionMet = ARM_COND_GE;
-			break;
-		case 0xB:
-			conditionMet = ARM_COND_LT;
-			break;
-		case 0xC:
-			conditionMet = ARM_COND_GT;
-			break;
-		case 0xD:
-			conditionMet = ARM_COND_LE;
-			break;
-		default:
-			break;
-		}
-		if (!conditionMet) {
-			cpu->cycles += ARM_PREFETCH_CYCLES;
-			return;
-		}
+	if (condition != 0xE && !_ARMTestCondition(cpu, condition)) {
+		cpu->cycles += ARM_PREFETCH_CYCLES;
+		return;
 	}
 	//							 _armTable[ [27-25][24-21][20]0000  |  00000000[7-4] ] = _armTable[ [27-25][24-21][20][7-4] ]
 	ARMInstruction instruction = _armTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)];
@@ -291,8 +242,24 @@ void ARMRun(struct ARMCore* cpu) {
 	}
 }
 
+//单步执行一条指令，不处理事件
+void ARMStepInstruction(struct ARMCore* cpu) {
+	if (cpu->executionMode == MODE_THUMB) {
+		ThumbStep(cpu);
+	} else {
+		ARMStep(cpu);
+	}
+}
+
 //指令循环
 void ARMRunLoop(struct ARMCore* cpu) {
+#ifdef USE_THREADED_DISPATCH
+	if (cpu->executionMode == MODE_THUMB) {
+		_thumbRunLoop(cpu);
+	} else {
+		_armRunLoop(cpu);
+	}
+#else
 	if (cpu->executionMode == MODE_THUMB) {
 		while (cpu->cycles < cpu->nextEvent) {
 			ThumbStep(cpu);
@@ -302,5 +269,6 @@ void ARMRunLoop(struct ARMCore* cpu) {
 			ARMStep(cpu);
 		}
 	}
+#endif
 	cpu->irqh.processEvents(cpu);
 }
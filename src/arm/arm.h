@@ -285,6 +285,44 @@ union PSR {
 	int32_t packed;
 };
 
+#define ARM_FAST_REGION_SHIFT 24
+#define ARM_FAST_REGION_COUNT 16
+
+#define ARM_FAST_LOAD   0x01		//允许直接读取
+#define ARM_FAST_STORE  0x02		//允许直接写入半字和字
+#define ARM_FAST_STORE8 0x04		//允许直接写入字节
+
+#define ARM_FAST_CYCLE_SETS 4		//每个区域预先算好的周期数组数，宿主通过cpu->memory.fastCycleSet选用其中一组
+
+enum ARMFastCycles {
+	ARM_FAST_LOAD32_CYCLES,			//32位读取的总周期数
+	ARM_FAST_LOAD16_CYCLES,			//16位和8位读取的总周期数
+	ARM_FAST_STORE32_CYCLES,		//32位写入的总周期数
+	ARM_FAST_STORE16_CYCLES,		//16位和8位写入的总周期数
+	ARM_FAST_CYCLES_MAX
+};
+
+// 按地址[27:24]位统计数据访存次数，仅在定义USE_PERF_COUNTERS时生效
+#ifdef USE_PERF_COUNTERS
+#define ARM_COUNT_ACCESSES(CPU, ADDRESS, N) ((CPU)->memory.accessCounts[((ADDRESS) >> ARM_FAST_REGION_SHIFT) & (ARM_FAST_REGION_COUNT - 1)] += (N))
+#else
+#define ARM_COUNT_ACCESSES(CPU, ADDRESS, N)
+#endif
+#define ARM_COUNT_ACCESS(CPU, ADDRESS) ARM_COUNT_ACCESSES(CPU, ADDRESS, 1)
+
+/*
+快速访存表，以地址的[27:24]位为下标
+(address & mask) < size 且对齐的访问直接读写base，不调用load32等函数，其余情况（I/O、SRAM、越界等）仍走慢速路径
+*/
+struct ARMFastRegion {
+	uint8_t* base;				//宿主内存基址
+	uint32_t mask;
+	uint32_t size;				//为0时该区域总是走慢速路径
+	uint32_t* generations;		//写入时要递增的页代数（见block-cache.h），可为0
+	uint8_t flags;
+	int8_t cycles[ARM_FAST_CYCLE_SETS][ARM_FAST_CYCLES_MAX];	//总周期数，由宿主按等待周期（以及预取等效果）计算
+};
+
 struct ARMMemory {
 	//对应字数据加载指令LDR
 	int32_t (*load32)(struct ARMCore*, uint32_t address, int* cycleCounter);
@@ -318,6 +356,13 @@ struct ARMMemory {
 
 	//设置当前指令/事件基地址
 	void (*setActiveRegion)(struct ARMCore*, uint32_t address);
+
+	struct ARMFastRegion fastRegions[ARM_FAST_REGION_COUNT];
+	int fastCycleSet;					//快速路径使用的周期数组，切换时不必重建fastRegions
+
+#ifdef USE_PERF_COUNTERS
+	uint64_t accessCounts[ARM_FAST_REGION_COUNT];
+#endif
 };
 
 struct ARMInterruptHandler {									//ARM中断处理程序
@@ -376,5 +421,6 @@ void ARMRaiseSWI(struct ARMCore*);		//拉起SWI中断
 
 void ARMRun(struct ARMCore* cpu);		//单步运行
 void ARMRunLoop(struct ARMCore* cpu);	//循环运行
+void ARMStepInstruction(struct ARMCore* cpu);	//单步执行，不处理事件
 
 #endif
@@ -0,0 +1,260 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "block-cache.h"
+
+#include "decoder.h"
+#include "isa-inlines.h"
+
+const uint32_t ARM_BLOCK_CACHE_ID = 0x424C4B00;
+
+// 不可写区域中的块都指向这个代数，它永远不会改变
+static const uint32_t _immutableGeneration = 0;
+
+static void ARMBlockCacheInit(struct ARMCore* cpu, struct ARMComponent* component);
+static void ARMBlockCacheDeinit(struct ARMComponent* component);
+
+static const struct ARMCacheRange* _findRange(struct ARMBlockCache* cache, uint32_t address, int width) {
+	int i;
+	for (i = 0; i < cache->nRanges; ++i) {
+		const struct ARMCacheRange* range = &cache->ranges[i];
+		if (address >= range->start && address < range->end && range->end - address >= (uint32_t) width) {
+			return range;
+		}
+	}
+	return 0;
+}
+
+static void _decodeBlock(struct ARMCore* cpu, struct ARMCachedBlock* block, const struct ARMCacheRange* range) {
+	enum ExecutionMode mode = block->mode;
+	int width = mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	uint32_t end = range->end;
+	if (range->generations) {
+		uint32_t page = (block->address - range->start) >> ARM_BLOCK_CACHE_PAGE_BITS;
+		uint32_t pageEnd = range->start + ((page + 1) << ARM_BLOCK_CACHE_PAGE_BITS);
+		if (pageEnd < end) {
+			end = pageEnd;
+		}
+		block->generation = &range->generations[page];
+	} else {
+		block->generation = &_immutableGeneration;
+	}
+	block->validGeneration = *block->generation;
+	block->range = range;
+
+	block->directBranch = false;
+	block->links[0] = 0;
+	block->links[1] = 0;
+
+	uint32_t address = block->address;
+	int i;
+	for (i = 0; i < ARM_BLOCK_CACHE_MAX_LENGTH; ++i) {
+		struct ARMCachedInstruction* instruction = &block->instructions[i];
+		struct ARMInstructionInfo info;
+		if (mode == MODE_THUMB) {
+			uint16_t opcode;
+			LOAD_16(opcode, address & cpu->memory.activeMask, cpu->memory.activeRegion);
+			instruction->opcode = opcode;
+			instruction->thumb = _thumbTable[opcode >> 6];
+			instruction->conditionMask = 0xFFFF;
+			ARMDecodeThumb(opcode, &info);
+		} else {
+			uint32_t opcode;
+			LOAD_32(opcode, address & cpu->memory.activeMask, cpu->memory.activeRegion);
+			instruction->opcode = opcode;
+			instruction->arm = _armTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)];
+			instruction->conditionMask = _armConditionTable[opcode >> 28];
+			ARMDecodeARM(opcode, &info);
+		}
+		if (info.branchType != ARM_BRANCH_NONE || info.traps || end - address < (uint32_t) width * 2) {
+			block->directBranch = (info.branchType == ARM_BRANCH || info.branchType == ARM_BRANCH_LINKED) && !info.traps;
+			++i;
+			break;
+		}
+		address += width;
+	}
+	block->length = i;
+}
+
+static struct ARMCachedBlock* _lookupBlock(struct ARMBlockCache* cache, uint32_t address, enum ExecutionMode mode) {
+	struct ARMCore* cpu = cache->cpu;
+	struct ARMCachedBlock** bucket = &cache->table[(address >> 1) & ((1 << ARM_BLOCK_CACHE_HASH_BITS) - 1)];
+	struct ARMCachedBlock* block = *bucket;
+	while (block && (block->address != address || block->mode != mode)) {
+		block = block->next;
+	}
+	if (!block) {
+		const struct ARMCacheRange* range = _findRange(cache, address, mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM);
+		if (!range || range->region != cpu->memory.activeRegion) {
+			return 0;
+		}
+		if (cache->nBlocks >= ARM_BLOCK_CACHE_MAX_BLOCKS) {
+			ARMBlockCacheFlush(cache);
+		}
+		block = &cache->blocks[cache->nBlocks];
+		++cache->nBlocks;
+		block->address = address;
+		block->mode = mode;
+		block->next = *bucket;
+		*bucket = block;
+		_decodeBlock(cpu, block, range);
+	} else if (*block->generation != block->validGeneration) {
+		if (block->range->region != cpu->memory.activeRegion) {
+			return 0;
+		}
+		_decodeBlock(cpu, block, block->range);
+	}
+	if (block->range->region != cpu->memory.activeRegion || block->instructions[0].opcode != cpu->prefetch) {
+		// 写回PC后解释器取到的指令可能与缓存中的不同
+		return 0;
+	}
+	return block;
+}
+
+// 链接只是某个出口上一次查到的块的缓存，使用前要像_lookupBlock一样检查它仍然有效
+static struct ARMCachedBlock* _followLink(struct ARMCore* cpu, const struct ARMCachedBlock* block, uint32_t address, enum ExecutionMode mode) {
+	int width = mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	struct ARMCachedBlock* link;
+	if (address == block->address + block->length * width) {
+		link = block->links[1];
+	} else {
+		link = block->links[0];
+	}
+	if (!link || link->address != address || link->mode != mode) {
+		return 0;
+	}
+	if (*link->generation != link->validGeneration || link->range->region != cpu->memory.activeRegion || link->instructions[0].opcode != cpu->prefetch) {
+		return 0;
+	}
+	return link;
+}
+
+static void _link(struct ARMCachedBlock* block, struct ARMCachedBlock* next, uint32_t address) {
+	int width = block->mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	uint32_t end = block->address + block->length * width;
+	if (address == end) {
+		block->links[1] = next;
+	} else if (block->directBranch && (address < block->address || address > end)) {
+		// 块中途退出（事件到达或自修改）时的地址落在块内，不记录
+		block->links[0] = next;
+	}
+}
+
+static void _runARMBlock(struct ARMCore* cpu, const struct ARMCachedBlock* block) {
+	uint32_t pc = block->address + WORD_SIZE_ARM;
+	int i;
+	for (i = 0; i < block->length; ++i) {
+		const struct ARMCachedInstruction* instruction = &block->instructions[i];
+		if (i + 1 < block->length) {
+			cpu->prefetch = instruction[1].opcode;
+		} else {
+			LOAD_32(cpu->prefetch, pc & cpu->memory.activeMask, cpu->memory.activeRegion);
+		}
+		pc += WORD_SIZE_ARM;
+		cpu->gprs[ARM_PC] = pc;
+		if (instruction->conditionMask & (1 << ((uint32_t) cpu->cpsr.packed >> 28))) {
+			instruction->arm(cpu, instruction->opcode);
+		} else {
+			cpu->cycles += ARM_PREFETCH_CYCLES;
+		}
+		if (cpu->gprs[ARM_PC] != (int32_t) pc || cpu->cycles >= cpu->nextEvent || *block->generation != block->validGeneration) {
+			return;
+		}
+	}
+}
+
+static void _runThumbBlock(struct ARMCore* cpu, const struct ARMCachedBlock* block) {
+	uint32_t pc = block->address + WORD_SIZE_THUMB;
+	int i;
+	for (i = 0; i < block->length; ++i) {
+		const struct ARMCachedInstruction* instruction = &block->instructions[i];
+		if (i + 1 < block->length) {
+			cpu->prefetch = instruction[1].opcode;
+		} else {
+			LOAD_16(cpu->prefetch, pc & cpu->memory.activeMask, cpu->memory.activeRegion);
+		}
+		pc += WORD_SIZE_THUMB;
+		cpu->gprs[ARM_PC] = pc;
+		instruction->thumb(cpu, instruction->opcode);
+		if (cpu->gprs[ARM_PC] != (int32_t) pc || cpu->cycles >= cpu->nextEvent || *block->generation != block->validGeneration) {
+			return;
+		}
+	}
+}
+
+void ARMBlockCacheCreate(struct ARMBlockCache* cache) {
+	cache->d.id = ARM_BLOCK_CACHE_ID;
+	cache->d.init = ARMBlockCacheInit;
+	cache->d.deinit = ARMBlockCacheDeinit;
+	cache->cpu = 0;
+	cache->blocks = 0;
+	cache->table = 0;
+	cache->nRanges = 0;
+}
+
+static void ARMBlockCacheInit(struct ARMCore* cpu, struct ARMComponent* component) {
+	struct ARMBlockCache* cache = (struct ARMBlockCache*) component;
+	cache->cpu = cpu;
+	cache->blocks = malloc(sizeof(struct ARMCachedBlock) * ARM_BLOCK_CACHE_MAX_BLOCKS);
+	cache->table = calloc(1 << ARM_BLOCK_CACHE_HASH_BITS, sizeof(struct ARMCachedBlock*));
+	cache->nBlocks = 0;
+}
+
+static void ARMBlockCacheDeinit(struct ARMComponent* component) {
+	struct ARMBlockCache* cache = (struct ARMBlockCache*) component;
+	free(cache->blocks);
+	free(cache->table);
+}
+
+void ARMBlockCacheAddRange(struct ARMBlockCache* cache, uint32_t start, uint32_t end, const void* region, uint32_t* generations) {
+	if (cache->nRanges >= ARM_BLOCK_CACHE_MAX_RANGES) {
+		return;
+	}
+	cache->ranges[cache->nRanges].start = start;
+	cache->ranges[cache->nRanges].end = end;
+	cache->ranges[cache->nRanges].region = region;
+	cache->ranges[cache->nRanges].generations = generations;
+	++cache->nRanges;
+}
+
+void ARMBlockCacheClearRanges(struct ARMBlockCache* cache) {
+	cache->nRanges = 0;
+	ARMBlockCacheFlush(cache);
+}
+
+void ARMBlockCacheFlush(struct ARMBlockCache* cache) {
+	cache->nBlocks = 0;
+	memset(cache->table, 0, sizeof(struct ARMCachedBlock*) << ARM_BLOCK_CACHE_HASH_BITS);
+}
+
+void ARMBlockCacheRunLoop(struct ARMBlockCache* cache) {
+	struct ARMCore* cpu = cache->cpu;
+	struct ARMCachedBlock* previous = 0;
+	while (cpu->cycles < cpu->nextEvent) {
+		enum ExecutionMode mode = cpu->executionMode;
+		uint32_t address = cpu->gprs[ARM_PC] - (mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM);
+		struct ARMCachedBlock* block = 0;
+		if (previous) {
+			block = _followLink(cpu, previous, address, mode);
+		}
+		if (!block) {
+			int nBlocks = cache->nBlocks;
+			block = _lookupBlock(cache, address, mode);
+			if (block && previous && cache->nBlocks >= nBlocks) {
+				// 查找时如果清空了缓存，previous已经失效
+				_link(previous, block, address);
+			}
+		}
+		previous = block;
+		if (!block) {
+			ARMStepInstruction(cpu);
+		} else if (mode == MODE_THUMB) {
+			_runThumbBlock(cpu, block);
+		} else {
+			_runARMBlock(cpu, block);
+		}
+	}
+	cpu->irqh.processEvents(cpu);
+}
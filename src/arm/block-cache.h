@@ -0,0 +1,78 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef ARM_BLOCK_CACHE_H
+#define ARM_BLOCK_CACHE_H
+
+#include "util/common.h"
+
+#include "arm.h"
+#include "isa-arm.h"
+#include "isa-thumb.h"
+
+/*
+预解码块缓存（线程化解释器）
+将一段连续的ARM/Thumb指令解码一次，保存每条指令的解释器函数指针、机器码和条件码真值表，之后直接从缓存执行
+不可写的区域（BIOS、卡带ROM）中的块永久有效
+可写的区域按页记录“代数”，每次写入该页时代数加一，块中记录的代数与当前代数不同时重新解码
+以直接分支（B、BL、Thumb条件分支）结尾的块会记住分支目标和顺序执行的后继块，下次直接跳过去而不用查哈希表
+*/
+
+extern const uint32_t ARM_BLOCK_CACHE_ID;
+
+#define ARM_BLOCK_CACHE_MAX_BLOCKS 0x2000
+#define ARM_BLOCK_CACHE_MAX_LENGTH 32
+#define ARM_BLOCK_CACHE_HASH_BITS 12
+#define ARM_BLOCK_CACHE_MAX_RANGES 8
+#define ARM_BLOCK_CACHE_PAGE_BITS 8		//可写区域的页大小为256字节，块不会跨页
+
+struct ARMCachedInstruction {
+	union {
+		ARMInstruction arm;
+		ThumbInstruction thumb;
+	};
+	uint32_t opcode;
+	uint16_t conditionMask;		//第n位表示NZCV == n时条件成立，Thumb指令总是0xFFFF
+};
+
+struct ARMCacheRange {
+	uint32_t start;
+	uint32_t end;
+	const uint32_t* region;		//该地址范围对应的cpu->memory.activeRegion
+	uint32_t* generations;		//每页的代数，不可写的区域为0
+};
+
+struct ARMCachedBlock {
+	struct ARMCachedBlock* next;	//同一哈希桶中的下一个块
+	uint32_t address;
+	enum ExecutionMode mode;
+	const struct ARMCacheRange* range;
+	const uint32_t* generation;		//块所在页的代数
+	uint32_t validGeneration;		//解码时的代数
+	int length;
+	bool directBranch;				//最后一条指令是目标固定的分支
+	struct ARMCachedBlock* links[2];	//0：分支目标，1：顺序执行的后继块；重新解码时清空
+	struct ARMCachedInstruction instructions[ARM_BLOCK_CACHE_MAX_LENGTH];
+};
+
+struct ARMBlockCache {
+	struct ARMComponent d;
+	struct ARMCore* cpu;
+
+	struct ARMCachedBlock* blocks;
+	int nBlocks;
+	struct ARMCachedBlock** table;
+
+	struct ARMCacheRange ranges[ARM_BLOCK_CACHE_MAX_RANGES];
+	int nRanges;
+};
+
+void ARMBlockCacheCreate(struct ARMBlockCache* cache);
+void ARMBlockCacheAddRange(struct ARMBlockCache* cache, uint32_t start, uint32_t end, const void* region, uint32_t* generations);
+void ARMBlockCacheClearRanges(struct ARMBlockCache* cache);
+void ARMBlockCacheFlush(struct ARMBlockCache* cache);
+void ARMBlockCacheRunLoop(struct ARMBlockCache* cache);
+
+#endif
@@ -309,6 +309,13 @@ static const char* _armAccessTypeStrings[] = {
 	""
 };
 
+const char* ARMMnemonicName(enum ARMMnemonic mnemonic) {
+	if (mnemonic >= ARM_MN_MAX) {
+		mnemonic = ARM_MN_MAX;
+	}
+	return _armMnemonicStrings[mnemonic];
+}
+
 //反汇编解码
 int ARMDisassemble(struct ARMInstructionInfo* info, uint32_t pc, char* buffer, int blen) {	
 	const char* mnemonic = _armMnemonicStrings[info->mnemonic];
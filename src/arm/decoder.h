@@ -208,5 +208,6 @@ struct ARMInstructionInfo {		//指令信息
 void ARMDecodeARM(uint32_t opcode, struct ARMInstructionInfo* info);						//解码ARM汇编指令
 void ARMDecodeThumb(uint16_t opcode, struct ARMInstructionInfo* info);						//解码THUMB汇编指令
 int ARMDisassemble(struct ARMInstructionInfo* info, uint32_t pc, char* buffer, int blen);	//反汇编
+const char* ARMMnemonicName(enum ARMMnemonic mnemonic);									//助记符名称
 
 #endif
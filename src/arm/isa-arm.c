@@ -13,6 +13,25 @@
 #define PSR_PRIV_MASK   0x000000CF //中断使能位和工作模式
 #define PSR_STATE_MASK  0x00000020 //工作状态标志位
 
+const uint16_t _armConditionTable[16] = {
+	0xF0F0, // EQ
+	0x0F0F, // NE
+	0xCCCC, // CS
+	0x3333, // CC
+	0xFF00, // MI
+	0x00FF, // PL
+	0xAAAA, // VS
+	0x5555, // VC
+	0x0C0C, // HI
+	0xF3F3, // LS
+	0xAA55, // GE
+	0x55AA, // LT
+	0x0A05, // GT
+	0xF5FA, // LE
+	0xFFFF, // AL
+	0x0000  // NV
+};
+
 /*
 Addressing mode 1：Shifter operands for data processing instructions(数据处理指令中的**移位操作数**的计算方法)
 首先，数据处理指令或者说使用移位操作数的指令有：ADD ADC SUB SBC RSB RSC CMP CMN TST TEQ AND EOR ORR BIC MOV MVN
@@ -232,43 +251,34 @@ static inline void _immediate(struct ARMCore* cpu, uint32_t opcode) {
 
 //设置了S标志位的数据处理指令
 #define ARM_ADDITION_S(M, N, D) \
-	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+	if (UNLIKELY(rd == ARM_PC) && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
-		cpu->cpsr.n = ARM_SIGN(D); \
-		cpu->cpsr.z = !(D); \
-		cpu->cpsr.c = ARM_CARRY_FROM(M, N, D); \
-		cpu->cpsr.v = ARM_V_ADDITION(M, N, D); \
+		ARM_SET_NZCV(ARM_SIGN(D), !(D), ARM_CARRY_FROM(M, N, D), ARM_V_ADDITION(M, N, D)); \
 	}
 
 //设置了S标志的减法指令
 #define ARM_SUBTRACTION_S(M, N, D) \
-	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+	if (UNLIKELY(rd == ARM_PC) && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
-		cpu->cpsr.n = ARM_SIGN(D); \
-		cpu->cpsr.z = !(D); \
-		cpu->cpsr.c = ARM_BORROW_FROM(M, N, D); \
-		cpu->cpsr.v = ARM_V_SUBTRACTION(M, N, D); \
+		ARM_SET_NZCV(ARM_SIGN(D), !(D), ARM_BORROW_FROM(M, N, D), ARM_V_SUBTRACTION(M, N, D)); \
 	}
 
 //设置了S标志为的??指令	
 #define ARM_NEUTRAL_S(M, N, D) \
-	if (rd == ARM_PC && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
+	if (UNLIKELY(rd == ARM_PC) && _ARMModeHasSPSR(cpu->cpsr.priv)) { \
 		cpu->cpsr = cpu->spsr; \
 		_ARMReadCPSR(cpu); \
 	} else { \
-		cpu->cpsr.n = ARM_SIGN(D); \
-		cpu->cpsr.z = !(D); \
-		cpu->cpsr.c = cpu->shifterCarryOut; \
+		ARM_SET_NZC(ARM_SIGN(D), !(D), cpu->shifterCarryOut); \
 	}
 
 //??
 #define ARM_NEUTRAL_HI_S(DLO, DHI) \
-	cpu->cpsr.n = ARM_SIGN(DHI); \
-	cpu->cpsr.z = !((DHI) | (DLO));
+	ARM_SET_NZ(ARM_SIGN(DHI), !((DHI) | (DLO)));
 
 /*
 v4架构所有数据加载/存储指令：LDR LDRT LDRB LDRBT LDRH LDRSB LDRSH STR STRT STRB STRBT STRH
@@ -381,703 +391,7 @@ DB(Decrement before)：        Cond 1 0 0 1 0 S W L Rn register-list
 		cpu->cycles += currentCycles; \
 	}
 
-/*
-宏定义：DEFINE_ALU_INSTRUCTION_EX_ARM(NAME, S_BODY, SHIFTER, BODY)
-替换文本：
-static void _ARMInstruction ## NAME (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rn = (opcode >> 16) & 0xF;
-		UNUSED(rn);
-		SHIFTER(cpu, opcode);
-		BODY;
-		S_BODY;
-		if (rd == ARM_PC) {
-			if (cpu->executionMode == MODE_ARM) {
-				ARM_WRITE_PC;
-			} else {
-				THUMB_WRITE_PC;
-			}
-		}
-		cpu->cycles += currentCycles;
-	}
-*/
-//算数逻辑指令需要在ARM指令宏上扩展,
-//数据处理指令格式：Cond(31-28) 0 0 0/1 Opcode(24-21) S(20) Rn(19-16) Rd(15-12) **Operand2(11-0)**
-#define DEFINE_ALU_INSTRUCTION_EX_ARM(NAME, S_BODY, SHIFTER, BODY) \
-	DEFINE_INSTRUCTION_ARM(NAME, \
-		int rd = (opcode >> 12) & 0xF; \
-		int rn = (opcode >> 16) & 0xF; \
-		UNUSED(rn); \
-		SHIFTER(cpu, opcode); \
-		BODY; \
-		S_BODY; \
-		if (rd == ARM_PC) { \
-			if (cpu->executionMode == MODE_ARM) { \
-				ARM_WRITE_PC; \
-			} else { \
-				THUMB_WRITE_PC; \
-			} \
-		})
-
-/*
-宏定义：DEFINE_ALU_INSTRUCTION_ARM(NAME, S_BODY, BODY)
-替换文本：
-**DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, , _shiftLSL, BODY)**
-static void _ARMInstruction ## NAME ## _LSL (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rn = (opcode >> 16) & 0xF;
-		UNUSED(rn);
-		_shiftLSL(cpu, opcode);
-		BODY;
-		;
-		if (rd == ARM_PC) {
-			if (cpu->executionMode == MODE_ARM) {
-				ARM_WRITE_PC;
-			} else {
-				THUMB_WRITE_PC;
-			}
-		}
-		cpu->cycles += currentCycles;
-	}
-**DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSL, S_BODY, _shiftLSL, BODY)**
-static void _ARMInstruction ## NAME ## S_LSL (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rn = (opcode >> 16) & 0xF;
-		UNUSED(rn);
-		_shiftLSL(cpu, opcode);
-		BODY;
-		S_BODY;
-		if (rd == ARM_PC) {
-			if (cpu->executionMode == MODE_ARM) {
-				ARM_WRITE_PC;
-			} else {
-				THUMB_WRITE_PC;
-			}
-		}
-		cpu->cycles += currentCycles;
-	}
-	......
-*/
-//定义算数逻辑运算(算术、逻辑、比较)指令的宏
-#define DEFINE_ALU_INSTRUCTION_ARM(NAME, S_BODY, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, , _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSL, S_BODY, _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSLR, , _shiftLSLR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSLR, S_BODY, _shiftLSLR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, , _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSR, S_BODY, _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSRR, , _shiftLSRR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSRR, S_BODY, _shiftLSRR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, , _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASR, S_BODY, _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASRR, , _shiftASRR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASRR, S_BODY, _shiftASRR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, , _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ROR, S_BODY, _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _RORR, , _shiftRORR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_RORR, S_BODY, _shiftRORR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, , _immediate, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## SI, S_BODY, _immediate, BODY)
-
-#define DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(NAME, S_BODY, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, S_BODY, _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSLR, S_BODY, _shiftLSLR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, S_BODY, _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSRR, S_BODY, _shiftLSRR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, S_BODY, _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASRR, S_BODY, _shiftASRR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, S_BODY, _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _RORR, S_BODY, _shiftRORR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, S_BODY, _immediate, BODY)
-
-/*
-宏定义：DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, S_BODY)
-替换文本：
-static void _ARMInstruction ## NAME (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rdHi = (opcode >> 16) & 0xF;
-		int rs = (opcode >> 8) & 0xF;
-		int rm = opcode & 0xF;
-		UNUSED(rdHi);
-		ARM_WAIT_MUL(cpu->gprs[rs]);
-		BODY;
-		S_BODY;
-		if (rd == ARM_PC) {
-			ARM_WRITE_PC;
-		}
-		cpu->cycles += currentCycles;
-	}
-*/
-//乘法指令需要在ARM指令宏上扩展
-#define DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, S_BODY) \
-	DEFINE_INSTRUCTION_ARM(NAME, \
-		int rd = (opcode >> 12) & 0xF; \
-		int rdHi = (opcode >> 16) & 0xF; \
-		int rs = (opcode >> 8) & 0xF; \
-		int rm = opcode & 0xF; \
-		UNUSED(rdHi); \
-		ARM_WAIT_MUL(cpu->gprs[rs]); \
-		BODY; \
-		S_BODY; \
-		if (rd == ARM_PC) { \
-			ARM_WRITE_PC; \
-		})
-/*
-宏定义：DEFINE_MULTIPLY_INSTRUCTION_ARM(NAME, BODY, S_BODY)
-替换文本：
-**DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, )**
-static void _ARMInstruction ## NAME (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rdHi = (opcode >> 16) & 0xF;
-		int rs = (opcode >> 8) & 0xF;
-		int rm = opcode & 0xF;
-		UNUSED(rdHi);
-		ARM_WAIT_MUL(cpu->gprs[rs]);
-		BODY;
-		;
-		if (rd == ARM_PC) {
-			ARM_WRITE_PC;
-		}
-		cpu->cycles += currentCycles;
-	}
-**DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME ## S, BODY, S_BODY)**
-static void _ARMInstruction ## NAME ## S (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rdHi = (opcode >> 16) & 0xF;
-		int rs = (opcode >> 8) & 0xF;
-		int rm = opcode & 0xF;
-		UNUSED(rdHi);
-		ARM_WAIT_MUL(cpu->gprs[rs]);
-		BODY;
-		S_BODY;
-		if (rd == ARM_PC) {
-			ARM_WRITE_PC;
-		}
-		cpu->cycles += currentCycles;
-	}
-*/
-//定义乘法运算指令的宏
-#define DEFINE_MULTIPLY_INSTRUCTION_ARM(NAME, BODY, S_BODY) \
-	DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, ) \
-	DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME ## S, BODY, S_BODY)
-
-/*
-宏定义：DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME, ADDRESS, WRITEBACK, BODY)
-替换文本：
-static void _ARMInstruction ## NAME (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		uint32_t address;
-		int rn = (opcode >> 16) & 0xF;
-		int rd = (opcode >> 12) & 0xF;
-		int rm = opcode & 0xF;
-		UNUSED(rm);
-		address = ADDRESS;
-		WRITEBACK;
-		BODY;
-		cpu->cycles += currentCycles;
-	}
-*/
-//数据加载/存储指令需要在ARM指令宏上扩展
-#define DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME, ADDRESS, WRITEBACK, BODY) \
-	DEFINE_INSTRUCTION_ARM(NAME, \
-		uint32_t address; \
-		int rn = (opcode >> 16) & 0xF; \
-		int rd = (opcode >> 12) & 0xF; \
-		int rm = opcode & 0xF; \
-		UNUSED(rm); \
-		address = ADDRESS; \
-		WRITEBACK; \
-		BODY;)
-
-//定义数据加载/存储指令的宏
-#define DEFINE_LOAD_STORE_INSTRUCTION_SHIFTER_ARM(NAME, SHIFTER, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME, ADDR_MODE_2_RN, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(-, SHIFTER)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## U, ADDR_MODE_2_RN, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(+, SHIFTER)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## P, ADDR_MODE_2_INDEX(-, SHIFTER), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## PW, ADDR_MODE_2_INDEX(-, SHIFTER), ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_ADDRESS), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## PU, ADDR_MODE_2_INDEX(+, SHIFTER), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## PUW, ADDR_MODE_2_INDEX(+, SHIFTER), ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_ADDRESS), BODY)
-
-#define DEFINE_LOAD_STORE_INSTRUCTION_ARM(NAME, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_SHIFTER_ARM(NAME ## _LSL_, ADDR_MODE_2_LSL, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_SHIFTER_ARM(NAME ## _LSR_, ADDR_MODE_2_LSR, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_SHIFTER_ARM(NAME ## _ASR_, ADDR_MODE_2_ASR, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_SHIFTER_ARM(NAME ## _ROR_, ADDR_MODE_2_ROR, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## I, ADDR_MODE_2_RN, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(-, ADDR_MODE_2_IMMEDIATE)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IU, ADDR_MODE_2_RN, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(+, ADDR_MODE_2_IMMEDIATE)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IP, ADDR_MODE_2_INDEX(-, ADDR_MODE_2_IMMEDIATE), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IPW, ADDR_MODE_2_INDEX(-, ADDR_MODE_2_IMMEDIATE), ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_ADDRESS), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IPU, ADDR_MODE_2_INDEX(+, ADDR_MODE_2_IMMEDIATE), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IPUW, ADDR_MODE_2_INDEX(+, ADDR_MODE_2_IMMEDIATE), ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_ADDRESS), BODY) \
-
-#define DEFINE_LOAD_STORE_MODE_3_INSTRUCTION_ARM(NAME, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME, ADDR_MODE_3_RN, ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_INDEX(-, ADDR_MODE_3_RM)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## U, ADDR_MODE_3_RN, ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_INDEX(+, ADDR_MODE_3_RM)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## P, ADDR_MODE_3_INDEX(-, ADDR_MODE_3_RM), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## PW, ADDR_MODE_3_INDEX(-, ADDR_MODE_3_RM), ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_ADDRESS), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## PU, ADDR_MODE_3_INDEX(+, ADDR_MODE_3_RM), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## PUW, ADDR_MODE_3_INDEX(+, ADDR_MODE_3_RM), ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_ADDRESS), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## I, ADDR_MODE_3_RN, ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_INDEX(-, ADDR_MODE_3_IMMEDIATE)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IU, ADDR_MODE_3_RN, ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_INDEX(+, ADDR_MODE_3_IMMEDIATE)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IP, ADDR_MODE_3_INDEX(-, ADDR_MODE_3_IMMEDIATE), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IPW, ADDR_MODE_3_INDEX(-, ADDR_MODE_3_IMMEDIATE), ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_ADDRESS), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IPU, ADDR_MODE_3_INDEX(+, ADDR_MODE_3_IMMEDIATE), , BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IPUW, ADDR_MODE_3_INDEX(+, ADDR_MODE_3_IMMEDIATE), ADDR_MODE_3_WRITEBACK(ADDR_MODE_3_ADDRESS), BODY) \
-
-#define DEFINE_LOAD_STORE_T_INSTRUCTION_SHIFTER_ARM(NAME, SHIFTER, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME, SHIFTER, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(-, ADDR_MODE_2_RM)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## U, SHIFTER, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(+, ADDR_MODE_2_RM)), BODY) \
-
-#define DEFINE_LOAD_STORE_T_INSTRUCTION_ARM(NAME, BODY) \
-	DEFINE_LOAD_STORE_T_INSTRUCTION_SHIFTER_ARM(NAME ## _LSL_, ADDR_MODE_2_LSL, BODY) \
-	DEFINE_LOAD_STORE_T_INSTRUCTION_SHIFTER_ARM(NAME ## _LSR_, ADDR_MODE_2_LSR, BODY) \
-	DEFINE_LOAD_STORE_T_INSTRUCTION_SHIFTER_ARM(NAME ## _ASR_, ADDR_MODE_2_ASR, BODY) \
-	DEFINE_LOAD_STORE_T_INSTRUCTION_SHIFTER_ARM(NAME ## _ROR_, ADDR_MODE_2_ROR, BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## I, ADDR_MODE_2_RN, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(-, ADDR_MODE_2_IMMEDIATE)), BODY) \
-	DEFINE_LOAD_STORE_INSTRUCTION_EX_ARM(NAME ## IU, ADDR_MODE_2_RN, ADDR_MODE_2_WRITEBACK(ADDR_MODE_2_INDEX(+, ADDR_MODE_2_IMMEDIATE)), BODY) \
-
-#define ARM_MS_PRE \
-	enum PrivilegeMode privilegeMode = cpu->privilegeMode; \
-	ARMSetPrivilegeMode(cpu, MODE_SYSTEM);
-
-#define ARM_MS_POST ARMSetPrivilegeMode(cpu, privilegeMode);
-
-/*0.9.3
-#define ARM_MS_PRE_store \
-	enum PrivilegeMode privilegeMode = cpu->privilegeMode; \
-	ARMSetPrivilegeMode(cpu, MODE_SYSTEM);
-
-#define ARM_MS_PRE_load \
-	enum PrivilegeMode privilegeMode; \
-	if (!(rs & 0x8000) && rs) { \
-		privilegeMode = cpu->privilegeMode; \
-		ARMSetPrivilegeMode(cpu, MODE_SYSTEM); \
-	}
-*/
-/*
-宏定义：DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME, LS, WRITEBACK, S_PRE, S_POST, DIRECTION, POST_BODY)
-替换文本：
-static void _ARMInstruction ## NAME (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rn = (opcode >> 16) & 0xF;
-		int rs = opcode & 0x0000FFFF;
-		uint32_t address = cpu->gprs[rn];
-		S_PRE;
-		address = cpu->memory. LS ## Multiple(cpu, address, rs, LSM_ ## DIRECTION, &currentCycles);
-		S_POST;
-		POST_BODY;
-		WRITEBACK;
-		cpu->cycles += currentCycles;
-	}
-*/
-//数据加载/存储指令需要在ARM指令宏上扩展
-#define DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME, LS, WRITEBACK, S_PRE, S_POST, DIRECTION, POST_BODY) \
-	DEFINE_INSTRUCTION_ARM(NAME, \
-		int rn = (opcode >> 16) & 0xF; \
-		int rs = opcode & 0x0000FFFF; \
-		uint32_t address = cpu->gprs[rn]; \
-		S_PRE; \
-		address = cpu->memory. LS ## Multiple(cpu, address, rs, LSM_ ## DIRECTION, &currentCycles); \
-		S_POST; \
-		POST_BODY; \
-		WRITEBACK;)
-
-//定义数据加载/存储（多个）指令的宏
-#define DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_ARM(NAME, LS, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## DA,   LS,                               ,           ,            , DA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## DAW,  LS, ADDR_MODE_4_WRITEBACK_ ## NAME,           ,            , DA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## DB,   LS,                               ,           ,            , DB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## DBW,  LS, ADDR_MODE_4_WRITEBACK_ ## NAME,           ,            , DB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## IA,   LS,                               ,           ,            , IA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## IAW,  LS, ADDR_MODE_4_WRITEBACK_ ## NAME,           ,            , IA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## IB,   LS,                               ,           ,            , IB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## IBW,  LS, ADDR_MODE_4_WRITEBACK_ ## NAME,           ,            , IB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SDA,  LS,                               , ARM_MS_PRE, ARM_MS_POST, DA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SDAW, LS, ADDR_MODE_4_WRITEBACK_ ## NAME, ARM_MS_PRE, ARM_MS_POST, DA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SDB,  LS,                               , ARM_MS_PRE, ARM_MS_POST, DB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SDBW, LS, ADDR_MODE_4_WRITEBACK_ ## NAME, ARM_MS_PRE, ARM_MS_POST, DB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SIA,  LS,                               , ARM_MS_PRE, ARM_MS_POST, IA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SIAW, LS, ADDR_MODE_4_WRITEBACK_ ## NAME, ARM_MS_PRE, ARM_MS_POST, IA, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SIB,  LS,                               , ARM_MS_PRE, ARM_MS_POST, IB, POST_BODY) \
-	DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_EX_ARM(NAME ## SIBW, LS, ADDR_MODE_4_WRITEBACK_ ## NAME, ARM_MS_PRE, ARM_MS_POST, IB, POST_BODY)
-
-/* Begin ALU definitions，开始ALU指令定义
-
-   Arithmetic: ADD ADC SUB SBC RSB RSC CMP CMN
-      Logical: AND EOR ORR BIC TST TEQ
-         Move: MOV MVN
-*/
-/* 原宏定义：DEFINE_ALU_INSTRUCTION_ARM(NAME, S_BODY, BODY)
-	DEFINE_ALU_INSTRUCTION_ARM(ADD, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs[rd]),
-			int32_t n = cpu->gprs[rn];
-			cpu->gprs[rd] = n + cpu->shifterOperand;)
-展开为：
-**DEFINE_ALU_INSTRUCTION_EX_ARM(ADD ## _LSL, , _shiftLSL, int32_t n = cpu->gprs[rn]; cpu->gprs[rd] = n + cpu->shifterOperand;)**
-static void _ARMInstruction ## ADD ## _LSL (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rn = (opcode >> 16) & 0xF;
-		UNUSED(rn);
-		_shiftLSL(cpu, opcode);
-		int32_t n = cpu->gprs[rn]; 
-		cpu->gprs[rd] = n + cpu->shifterOperand;;
-		;
-		if (rd == ARM_PC) {
-			if (cpu->executionMode == MODE_ARM) {
-				ARM_WRITE_PC;
-			} else {
-				THUMB_WRITE_PC;
-			}
-		}
-		cpu->cycles += currentCycles;
-	}
-**DEFINE_ALU_INSTRUCTION_EX_ARM(ADD ## S_LSL, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs[rd]), _shiftLSL, 
-								int32_t n = cpu->gprs[rn];
-	                            cpu->gprs[rd] = n + cpu->shifterOperand;)**
-static void _ARMInstruction ## ADD ## S_LSL (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rn = (opcode >> 16) & 0xF;
-		UNUSED(rn);
-		_shiftLSL(cpu, opcode);
-		int32_t n = cpu->gprs[rn];
-	    cpu->gprs[rd] = n + cpu->shifterOperand;;
-		ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs[rd]);;
-		if (rd == ARM_PC) {
-			if (cpu->executionMode == MODE_ARM) {
-				ARM_WRITE_PC;
-			} else {
-				THUMB_WRITE_PC;
-			}
-		}
-		cpu->cycles += currentCycles;
-	}
-	......
-*/
-DEFINE_ALU_INSTRUCTION_ARM(ADD, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs[rd]),
-	int32_t n = cpu->gprs[rn];
-	cpu->gprs[rd] = n + cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(ADC, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs[rd]),
-	int32_t n = cpu->gprs[rn];
-	cpu->gprs[rd] = n + cpu->shifterOperand + cpu->cpsr.c;)
-
-DEFINE_ALU_INSTRUCTION_ARM(AND, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = cpu->gprs[rn] & cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(BIC, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = cpu->gprs[rn] & ~cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(CMN, ARM_ADDITION_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
-	int32_t aluOut = cpu->gprs[rn] + cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(CMP, ARM_SUBTRACTION_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
-	int32_t aluOut = cpu->gprs[rn] - cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(EOR, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = cpu->gprs[rn] ^ cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(MOV, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(MVN, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = ~cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(ORR, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
-	cpu->gprs[rd] = cpu->gprs[rn] | cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(RSB, ARM_SUBTRACTION_S(cpu->shifterOperand, n, cpu->gprs[rd]),
-	int32_t n = cpu->gprs[rn];
-	cpu->gprs[rd] = cpu->shifterOperand - n;)
-
-DEFINE_ALU_INSTRUCTION_ARM(RSC, ARM_SUBTRACTION_S(cpu->shifterOperand, n, cpu->gprs[rd]),
-	int32_t n = cpu->gprs[rn] + !cpu->cpsr.c;
-	cpu->gprs[rd] = cpu->shifterOperand - n;)
-
-DEFINE_ALU_INSTRUCTION_ARM(SBC, ARM_SUBTRACTION_S(n, shifterOperand, cpu->gprs[rd]),
-	int32_t n = cpu->gprs[rn];
-	int32_t shifterOperand = cpu->shifterOperand + !cpu->cpsr.c;
-	cpu->gprs[rd] = n - shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_ARM(SUB, ARM_SUBTRACTION_S(n, cpu->shifterOperand, cpu->gprs[rd]),
-	int32_t n = cpu->gprs[rn];
-	cpu->gprs[rd] = n - cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(TEQ, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
-	int32_t aluOut = cpu->gprs[rn] ^ cpu->shifterOperand;)
-
-DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(TST, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
-	int32_t aluOut = cpu->gprs[rn] & cpu->shifterOperand;)
-
-// End ALU definitions，结束ALU指令定义
-
-/* Begin multiply definitions，开始乘法指令定义
-
-   MUL: Multiply
-   MLA: Multiply accumulate
-   UMULL: Multiply unsigned long
-   UMLAL: Multiply unsigned accumulate long
-   SMULL: Multiply signed long
-   SMLAL: Multiply signed accumulate long
-*/
-/*
-原宏定义：DEFINE_MULTIPLY_INSTRUCTION_ARM(NAME, BODY, S_BODY)
-DEFINE_MULTIPLY_INSTRUCTION_ARM(MLA, cpu->gprs[rdHi] = cpu->gprs[rm] * cpu->gprs[rs] + cpu->gprs[rd], ARM_NEUTRAL_S(, , cpu->gprs[rdHi]))
-替换文本：
-**DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, )**
-static void _ARMInstruction ## MLA (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rdHi = (opcode >> 16) & 0xF;
-		int rs = (opcode >> 8) & 0xF;
-		int rm = opcode & 0xF;
-		UNUSED(rdHi);
-		ARM_WAIT_MUL(cpu->gprs[rs]);
-		cpu->gprs[rdHi] = cpu->gprs[rm] * cpu->gprs[rs] + cpu->gprs[rd];
-		;
-		if (rd == ARM_PC) {
-			ARM_WRITE_PC;
-		}
-		cpu->cycles += currentCycles;
-	}
-**DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(MLA ## S, BODY, S_BODY)**
-static void _ARMInstruction ## MLA ## S (struct ARMCore* cpu, uint32_t opcode) {
-		int currentCycles = ARM_PREFETCH_CYCLES;
-		int rd = (opcode >> 12) & 0xF;
-		int rdHi = (opcode >> 16) & 0xF;
-		int rs = (opcode >> 8) & 0xF;
-		int rm = opcode & 0xF;
-		UNUSED(rdHi);
-		ARM_WAIT_MUL(cpu->gprs[rs]);
-		cpu->gprs[rdHi] = cpu->gprs[rm] * cpu->gprs[rs] + cpu->gprs[rd];
-		ARM_NEUTRAL_S(, , cpu->gprs[rdHi]);
-		if (rd == ARM_PC) {
-			ARM_WRITE_PC;
-		}
-		cpu->cycles += currentCycles;
-	}
-*/
-DEFINE_MULTIPLY_INSTRUCTION_ARM(MLA, cpu->gprs[rdHi] = cpu->gprs[rm] * cpu->gprs[rs] + cpu->gprs[rd], ARM_NEUTRAL_S(, , cpu->gprs[rdHi]))
-DEFINE_MULTIPLY_INSTRUCTION_ARM(MUL, cpu->gprs[rdHi] = cpu->gprs[rm] * cpu->gprs[rs], ARM_NEUTRAL_S(cpu->gprs[rm], cpu->gprs[rs], cpu->gprs[rdHi]))
-
-DEFINE_MULTIPLY_INSTRUCTION_ARM(SMLAL,
-	int64_t d = ((int64_t) cpu->gprs[rm]) * ((int64_t) cpu->gprs[rs]);
-	int32_t dm = cpu->gprs[rd];
-	int32_t dn = d;
-	cpu->gprs[rd] = dm + dn;
-	cpu->gprs[rdHi] = cpu->gprs[rdHi] + (d >> 32) + ARM_CARRY_FROM(dm, dn, cpu->gprs[rd]);,
-	ARM_NEUTRAL_HI_S(cpu->gprs[rd], cpu->gprs[rdHi]))
-
-DEFINE_MULTIPLY_INSTRUCTION_ARM(SMULL,
-	int64_t d = ((int64_t) cpu->gprs[rm]) * ((int64_t) cpu->gprs[rs]);
-	cpu->gprs[rd] = d;
-	cpu->gprs[rdHi] = d >> 32;,
-	ARM_NEUTRAL_HI_S(cpu->gprs[rd], cpu->gprs[rdHi]))
-
-DEFINE_MULTIPLY_INSTRUCTION_ARM(UMLAL,
-	uint64_t d = NO_EXTEND64(cpu->gprs[rm]) * NO_EXTEND64(cpu->gprs[rs]);
-	int32_t dm = cpu->gprs[rd];
-	int32_t dn = d;
-	cpu->gprs[rd] = dm + dn;
-	cpu->gprs[rdHi] = cpu->gprs[rdHi] + (d >> 32) + ARM_CARRY_FROM(dm, dn, cpu->gprs[rd]);,
-	ARM_NEUTRAL_HI_S(cpu->gprs[rd], cpu->gprs[rdHi]))
-
-DEFINE_MULTIPLY_INSTRUCTION_ARM(UMULL,
-	uint64_t d = NO_EXTEND64(cpu->gprs[rm]) * NO_EXTEND64(cpu->gprs[rs]);
-	cpu->gprs[rd] = d;
-	cpu->gprs[rdHi] = d >> 32;,
-	ARM_NEUTRAL_HI_S(cpu->gprs[rd], cpu->gprs[rdHi]))
-
-// End multiply definitions，结束乘法指令定义
-
-/* Begin load/store definitions，开始加载/存储指令定义
-
-   LDR(LDRT) LDRH LDRB(LDRBT) LDRSH LDRSB
-   STR(STRT) STRH STRB(STRBT)
-   LDM
-   STM
-*/
-DEFINE_LOAD_STORE_INSTRUCTION_ARM(LDR, cpu->gprs[rd] = cpu->memory.load32(cpu, address, &currentCycles); ARM_LOAD_POST_BODY;)
-DEFINE_LOAD_STORE_INSTRUCTION_ARM(LDRB, cpu->gprs[rd] = cpu->memory.loadU8(cpu, address, &currentCycles); ARM_LOAD_POST_BODY;)
-DEFINE_LOAD_STORE_MODE_3_INSTRUCTION_ARM(LDRH, cpu->gprs[rd] = cpu->memory.loadU16(cpu, address, &currentCycles); ARM_LOAD_POST_BODY;)
-DEFINE_LOAD_STORE_MODE_3_INSTRUCTION_ARM(LDRSB, cpu->gprs[rd] = cpu->memory.load8(cpu, address, &currentCycles); ARM_LOAD_POST_BODY;)
-DEFINE_LOAD_STORE_MODE_3_INSTRUCTION_ARM(LDRSH, cpu->gprs[rd] = cpu->memory.load16(cpu, address, &currentCycles); ARM_LOAD_POST_BODY;)
-DEFINE_LOAD_STORE_INSTRUCTION_ARM(STR, cpu->memory.store32(cpu, address, cpu->gprs[rd], &currentCycles); ARM_STORE_POST_BODY;)
-DEFINE_LOAD_STORE_INSTRUCTION_ARM(STRB, cpu->memory.store8(cpu, address, cpu->gprs[rd], &currentCycles); ARM_STORE_POST_BODY;)
-DEFINE_LOAD_STORE_MODE_3_INSTRUCTION_ARM(STRH, cpu->memory.store16(cpu, address, cpu->gprs[rd], &currentCycles); ARM_STORE_POST_BODY;)
-
-DEFINE_LOAD_STORE_T_INSTRUCTION_ARM(LDRBT,
-	enum PrivilegeMode priv = cpu->privilegeMode;
-	ARMSetPrivilegeMode(cpu, MODE_USER);
-	cpu->gprs[rd] = cpu->memory.loadU8(cpu, address, &currentCycles);
-	ARMSetPrivilegeMode(cpu, priv);
-	ARM_LOAD_POST_BODY;)
-
-DEFINE_LOAD_STORE_T_INSTRUCTION_ARM(LDRT,
-	enum PrivilegeMode priv = cpu->privilegeMode;
-	ARMSetPrivilegeMode(cpu, MODE_USER);
-	cpu->gprs[rd] = cpu->memory.load32(cpu, address, &currentCycles);
-	ARMSetPrivilegeMode(cpu, priv);
-	ARM_LOAD_POST_BODY;)
-
-DEFINE_LOAD_STORE_T_INSTRUCTION_ARM(STRBT,
-	enum PrivilegeMode priv = cpu->privilegeMode;
-	ARMSetPrivilegeMode(cpu, MODE_USER);
-	cpu->memory.store32(cpu, address, cpu->gprs[rd], &currentCycles);
-	ARMSetPrivilegeMode(cpu, priv);
-	ARM_STORE_POST_BODY;)
-
-DEFINE_LOAD_STORE_T_INSTRUCTION_ARM(STRT,
-	enum PrivilegeMode priv = cpu->privilegeMode;
-	ARMSetPrivilegeMode(cpu, MODE_USER);
-	cpu->memory.store8(cpu, address, cpu->gprs[rd], &currentCycles);
-	ARMSetPrivilegeMode(cpu, priv);
-	ARM_STORE_POST_BODY;)
-
-DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_ARM(LDM,
-	load,
-	++currentCycles;
-	if (rs & 0x8000) {
-		ARM_WRITE_PC;
-	})
-
-DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_ARM(STM,
-	store,
-	currentCycles += cpu->memory.activeNonseqCycles32 - cpu->memory.activeSeqCycles32)
-
-DEFINE_INSTRUCTION_ARM(SWP,
-	int rm = opcode & 0xF;
-	int rd = (opcode >> 12) & 0xF;
-	int rn = (opcode >> 16) & 0xF;
-	int32_t d = cpu->memory.load32(cpu, cpu->gprs[rn], &currentCycles);
-	cpu->memory.store32(cpu, cpu->gprs[rn], cpu->gprs[rm], &currentCycles);
-	cpu->gprs[rd] = d;)
-
-DEFINE_INSTRUCTION_ARM(SWPB,
-	int rm = opcode & 0xF;
-	int rd = (opcode >> 12) & 0xF;
-	int rn = (opcode >> 16) & 0xF;
-	int32_t d = cpu->memory.loadU8(cpu, cpu->gprs[rn], &currentCycles);
-	cpu->memory.store8(cpu, cpu->gprs[rn], cpu->gprs[rm], &currentCycles);
-	cpu->gprs[rd] = d;)
-
-// End load/store definitions，结束加载/存储指令定义
-
-/* Begin branch definitions，开始分支指令定义
-
-   B: Branch
-   BL: Branch with link
-   BX: Branch and exchange instruction set
-*/
-DEFINE_INSTRUCTION_ARM(B,
-	int32_t offset = opcode << 8;
-	offset >>= 6;
-	cpu->gprs[ARM_PC] += offset;
-	ARM_WRITE_PC;)
-
-DEFINE_INSTRUCTION_ARM(BL,
-	int32_t immediate = (opcode & 0x00FFFFFF) << 8;
-	cpu->gprs[ARM_LR] = cpu->gprs[ARM_PC] - WORD_SIZE_ARM;
-	cpu->gprs[ARM_PC] += immediate >> 6;
-	ARM_WRITE_PC;)
-
-DEFINE_INSTRUCTION_ARM(BX,
-	int rm = opcode & 0x0000000F;
-	_ARMSetMode(cpu, cpu->gprs[rm] & 0x00000001);
-	cpu->gprs[ARM_PC] = cpu->gprs[rm] & 0xFFFFFFFE;
-	if (cpu->executionMode == MODE_THUMB) {
-		THUMB_WRITE_PC;
-	} else {
-		ARM_WRITE_PC;
-	})
-
-// End branch definitions，结束分支指令定义
-
-/* Begin coprocessor definitions，协处理器指令定义
-
-   CDP: Data operation
-   LDC: Load
-   STC: Store
-   MRC: Move to ARM register from coprocessor
-   MCR: Move to coprocessor from ARM register
-*/
-DEFINE_INSTRUCTION_ARM(CDP, ARM_STUB)
-DEFINE_INSTRUCTION_ARM(LDC, ARM_STUB)
-DEFINE_INSTRUCTION_ARM(STC, ARM_STUB)
-DEFINE_INSTRUCTION_ARM(MCR, ARM_STUB)
-DEFINE_INSTRUCTION_ARM(MRC, ARM_STUB)
-
-/* Begin miscellaneous definitions，杂项（不好分类的指令）
-
-   BKPT ILL
-   MSR MSRR MSRI MSRRI
-   MRS MRSR 
-   SWI
-*/
-DEFINE_INSTRUCTION_ARM(BKPT, ARM_STUB) // Not strictly in ARMv4T, but here for convenience
-DEFINE_INSTRUCTION_ARM(ILL, ARM_ILL) // Illegal opcode
-
-DEFINE_INSTRUCTION_ARM(MSR,
-	int c = opcode & 0x00010000;
-	int f = opcode & 0x00080000;
-	int32_t operand = cpu->gprs[opcode & 0x0000000F];
-	int32_t mask = (c ? 0x000000FF : 0) | (f ? 0xFF000000 : 0);
-	if (mask & PSR_USER_MASK) {
-		cpu->cpsr.packed = (cpu->cpsr.packed & ~PSR_USER_MASK) | (operand & PSR_USER_MASK);
-	}
-	if (cpu->privilegeMode != MODE_USER && (mask & PSR_PRIV_MASK)) {
-		ARMSetPrivilegeMode(cpu, (enum PrivilegeMode) ((operand & 0x0000000F) | 0x00000010));
-		cpu->cpsr.packed = (cpu->cpsr.packed & ~PSR_PRIV_MASK) | (operand & PSR_PRIV_MASK);
-	}
-	_ARMReadCPSR(cpu);)
-
-DEFINE_INSTRUCTION_ARM(MSRR,
-	int c = opcode & 0x00010000;
-	int f = opcode & 0x00080000;
-	int32_t operand = cpu->gprs[opcode & 0x0000000F];
-	int32_t mask = (c ? 0x000000FF : 0) | (f ? 0xFF000000 : 0);
-	mask &= PSR_USER_MASK | PSR_PRIV_MASK | PSR_STATE_MASK;
-	cpu->spsr.packed = (cpu->spsr.packed & ~mask) | (operand & mask);)
-
-DEFINE_INSTRUCTION_ARM(MRS, \
-	int rd = (opcode >> 12) & 0xF; \
-	cpu->gprs[rd] = cpu->cpsr.packed;)
-
-DEFINE_INSTRUCTION_ARM(MRSR, \
-	int rd = (opcode >> 12) & 0xF; \
-	cpu->gprs[rd] = cpu->spsr.packed;)
-
-DEFINE_INSTRUCTION_ARM(MSRI,
-	int c = opcode & 0x00010000;
-	int f = opcode & 0x00080000;
-	int rotate = (opcode & 0x00000F00) >> 7;
-	int32_t operand = ARM_ROR(opcode & 0x000000FF, rotate);
-	int32_t mask = (c ? 0x000000FF : 0) | (f ? 0xFF000000 : 0);
-	if (mask & PSR_USER_MASK) {
-		cpu->cpsr.packed = (cpu->cpsr.packed & ~PSR_USER_MASK) | (operand & PSR_USER_MASK);
-	}
-	if (cpu->privilegeMode != MODE_USER && (mask & PSR_PRIV_MASK)) {
-		ARMSetPrivilegeMode(cpu, (enum PrivilegeMode) ((operand & 0x0000000F) | 0x00000010));
-		cpu->cpsr.packed = (cpu->cpsr.packed & ~PSR_PRIV_MASK) | (operand & PSR_PRIV_MASK);
-	}
-	_ARMReadCPSR(cpu);)
-
-DEFINE_INSTRUCTION_ARM(MSRRI,
-	int c = opcode & 0x00010000;
-	int f = opcode & 0x00080000;
-	int rotate = (opcode & 0x00000F00) >> 7;
-	int32_t operand = ARM_ROR(opcode & 0x000000FF, rotate);
-	int32_t mask = (c ? 0x000000FF : 0) | (f ? 0xFF000000 : 0);
-	mask &= PSR_USER_MASK | PSR_PRIV_MASK | PSR_STATE_MASK;
-	cpu->spsr.packed = (cpu->spsr.packed & ~mask) | (operand & mask);)
-
-DEFINE_INSTRUCTION_ARM(SWI, cpu->irqh.swi32(cpu, opcode & 0xFFFFFF))
+#include "isa-arm-definitions.h"
 
 const ARMInstruction _armTable[0x1000] = {
 	DECLARE_ARM_EMITTER_BLOCK(_ARMInstruction)
@@ -1124,3 +438,75 @@ static void _ARMInstruction ## ADD ## _LSL (struct ARMCore* cpu, uint32_t opcode
 		cpu->cycles += currentCycles;
 	}
 */
+
+#ifdef USE_THREADED_DISPATCH
+/*
+线程化分派：将所有指令体展开到同一个函数中，省去每条指令一次的间接函数调用，编译器也可以在指令之间保留寄存器中的状态
+GCC/Clang使用computed goto，标签地址表由DECLARE_ARM_EMITTER_BLOCK生成；其他编译器使用switch
+*/
+#undef DEFINE_INSTRUCTION_ARM
+#ifdef __GNUC__
+#define DEFINE_INSTRUCTION_ARM(NAME, BODY) \
+	_ARMLabel ## NAME: { \
+		int currentCycles = ARM_PREFETCH_CYCLES; \
+		BODY; \
+		cpu->cycles += currentCycles; \
+		goto next; \
+	}
+
+void _armRunLoop(struct ARMCore* cpu) {
+	static const void* const labels[0x1000] = {
+		DECLARE_ARM_EMITTER_BLOCK(&&_ARMLabel)
+	};
+	uint32_t opcode;
+
+next:
+	if (cpu->cycles >= cpu->nextEvent) {
+		return;
+	}
+	opcode = cpu->prefetch;
+	LOAD_32(cpu->prefetch, cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+	cpu->gprs[ARM_PC] += WORD_SIZE_ARM;
+	if ((opcode >> 28) != 0xE && !_ARMTestCondition(cpu, opcode >> 28)) {
+		cpu->cycles += ARM_PREFETCH_CYCLES;
+		goto next;
+	}
+	goto *labels[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)];
+
+#include "isa-arm-definitions.h"
+}
+#else
+#define DEFINE_INSTRUCTION_ARM(NAME, BODY) _ARMCase ## NAME,
+enum ARMDispatchCase {
+#include "isa-arm-definitions.h"
+};
+
+static const uint16_t _armCases[0x1000] = {
+	DECLARE_ARM_EMITTER_BLOCK(_ARMCase)
+};
+
+#undef DEFINE_INSTRUCTION_ARM
+#define DEFINE_INSTRUCTION_ARM(NAME, BODY) \
+	case _ARMCase ## NAME: { \
+		int currentCycles = ARM_PREFETCH_CYCLES; \
+		BODY; \
+		cpu->cycles += currentCycles; \
+		break; \
+	}
+
+void _armRunLoop(struct ARMCore* cpu) {
+	while (cpu->cycles < cpu->nextEvent) {
+		uint32_t opcode = cpu->prefetch;
+		LOAD_32(cpu->prefetch, cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+		cpu->gprs[ARM_PC] += WORD_SIZE_ARM;
+		if ((opcode >> 28) != 0xE && !_ARMTestCondition(cpu, opcode >> 28)) {
+			cpu->cycles += ARM_PREFETCH_CYCLES;
+			continue;
+		}
+		switch (_armCases[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)]) {
+#include "isa-arm-definitions.h"
+		}
+	}
+}
+#endif
+#endif
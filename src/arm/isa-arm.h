@@ -15,5 +15,9 @@ struct ARMCore;
 typedef void (*ARMInstruction)(struct ARMCore*, uint32_t opcode);
 const ARMInstruction _armTable[0x1000];
 
+#ifdef USE_THREADED_DISPATCH
+void _armRunLoop(struct ARMCore* cpu);
+#endif
+
 
 #endif
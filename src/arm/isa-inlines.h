@@ -9,6 +9,7 @@
 #include "macros.h"
 
 #include "arm.h"
+#include "block-cache.h"
 
 /*
 每条ARM指令都包含4位条件码，位于指令最高4位[31:28]，通过条件码和cpsr寄存器的条件标志位的对比决定是否执行当前指令
@@ -55,6 +56,26 @@ V：溢出，改变标志位的最后的ALU操作产生到符号位的溢出
 //忽略，无条件执行
 #define ARM_COND_AL 1
 
+//条件码真值表：_armConditionTable[条件码]的第n位表示cpsr[31:28]（NZCV）== n时条件成立
+extern const uint16_t _armConditionTable[16];
+
+//根据条件码[31:28]和cpsr的条件标志位判断指令是否执行，0xF（NV）永不执行
+static inline bool _ARMTestCondition(struct ARMCore* cpu, unsigned condition) {
+	return _armConditionTable[condition] & (1 << ((uint32_t) cpu->cpsr.packed >> 28));
+}
+
+//一次写入条件标志位，每个值只取最低位，与逐个给位域赋值的结果相同
+#define ARM_SET_NZCV(N, Z, C, V) \
+	cpu->cpsr.packed = (cpu->cpsr.packed & 0x0FFFFFFF) | (((uint32_t) (N) & 1) << 31) | (((uint32_t) (Z) & 1) << 30) | \
+		(((uint32_t) (C) & 1) << 29) | (((uint32_t) (V) & 1) << 28)
+
+#define ARM_SET_NZC(N, Z, C) \
+	cpu->cpsr.packed = (cpu->cpsr.packed & 0x1FFFFFFF) | (((uint32_t) (N) & 1) << 31) | (((uint32_t) (Z) & 1) << 30) | \
+		(((uint32_t) (C) & 1) << 29)
+
+#define ARM_SET_NZ(N, Z) \
+	cpu->cpsr.packed = (cpu->cpsr.packed & 0x3FFFFFFF) | (((uint32_t) (N) & 1) << 31) | (((uint32_t) (Z) & 1) << 30)
+
 //取数据符号位，即最高位
 #define ARM_SIGN(I) ((I) >> 31)
 //循环右移操作
@@ -138,4 +159,129 @@ static inline void _ARMReadCPSR(struct ARMCore* cpu) {
 	cpu->irqh.readCPSR(cpu);
 }
 
+/*
+指令处理函数使用的访存函数
+命中cpu->memory.fastRegions时直接读写宿主内存，否则调用cpu->memory中的慢速函数
+周期数取自区域的cycles中由fastCycleSet选出的一组，由宿主保证与慢速路径一致
+无论是否命中都计入ARM_COUNT_ACCESS
+*/
+static inline const struct ARMFastRegion* _ARMFastRegion(struct ARMCore* cpu, uint32_t address, uint32_t* offset) {
+	uint32_t index = address >> ARM_FAST_REGION_SHIFT;
+	if (UNLIKELY(index >= ARM_FAST_REGION_COUNT)) {
+		return 0;
+	}
+	const struct ARMFastRegion* region = &cpu->memory.fastRegions[index];
+	*offset = address & region->mask;
+	if (*offset >= region->size) {
+		return 0;
+	}
+	return region;
+}
+
+static inline int32_t _ARMLoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_LOAD) && !(address & 3))) {
+		int32_t value;
+		LOAD_32(value, offset, region->base);
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_LOAD32_CYCLES];
+		return value;
+	}
+	return cpu->memory.load32(cpu, address, cycleCounter);
+}
+
+static inline uint16_t _ARMLoadU16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_LOAD) && !(address & 1))) {
+		uint16_t value;
+		LOAD_16(value, offset, region->base);
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_LOAD16_CYCLES];
+		return value;
+	}
+	return cpu->memory.loadU16(cpu, address, cycleCounter);
+}
+
+static inline int16_t _ARMLoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_LOAD) && !(address & 1))) {
+		uint16_t value;
+		LOAD_16(value, offset, region->base);
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_LOAD16_CYCLES];
+		return value;
+	}
+	return cpu->memory.load16(cpu, address, cycleCounter);
+}
+
+static inline uint8_t _ARMLoadU8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_LOAD))) {
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_LOAD16_CYCLES];
+		return region->base[offset];
+	}
+	return cpu->memory.loadU8(cpu, address, cycleCounter);
+}
+
+static inline int8_t _ARMLoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_LOAD))) {
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_LOAD16_CYCLES];
+		return region->base[offset];
+	}
+	return cpu->memory.load8(cpu, address, cycleCounter);
+}
+
+static inline void _ARMStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_STORE) && !(address & 3))) {
+		STORE_32(value, offset, region->base);
+		if (region->generations) {
+			++region->generations[offset >> ARM_BLOCK_CACHE_PAGE_BITS];
+		}
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_STORE32_CYCLES];
+		return;
+	}
+	cpu->memory.store32(cpu, address, value, cycleCounter);
+}
+
+static inline void _ARMStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_STORE) && !(address & 1))) {
+		STORE_16(value, offset, region->base);
+		if (region->generations) {
+			++region->generations[offset >> ARM_BLOCK_CACHE_PAGE_BITS];
+		}
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_STORE16_CYCLES];
+		return;
+	}
+	cpu->memory.store16(cpu, address, value, cycleCounter);
+}
+
+static inline void _ARMStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter) {
+	ARM_COUNT_ACCESS(cpu, address);
+	uint32_t offset;
+	const struct ARMFastRegion* region = _ARMFastRegion(cpu, address, &offset);
+	if (LIKELY(region && (region->flags & ARM_FAST_STORE8))) {
+		region->base[offset] = value;
+		if (region->generations) {
+			++region->generations[offset >> ARM_BLOCK_CACHE_PAGE_BITS];
+		}
+		*cycleCounter += region->cycles[cpu->memory.fastCycleSet][ARM_FAST_STORE16_CYCLES];
+		return;
+	}
+	cpu->memory.store8(cpu, address, value, cycleCounter);
+}
+
 #endif
@@ -13,4 +13,8 @@ struct ARMCore;
 typedef void (*ThumbInstruction)(struct ARMCore*, uint16_t opcode);
 const ThumbInstruction _thumbTable[0x400];
 
+#ifdef USE_THREADED_DISPATCH
+void _thumbRunLoop(struct ARMCore* cpu);
+#endif
+
 #endif
@@ -0,0 +1,780 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "jit.h"
+
+#include "decoder.h"
+#include "isa-arm.h"
+#include "isa-inlines.h"
+#include "isa-thumb.h"
+
+#include "util/memory.h"
+
+#if !defined(__x86_64__) && !defined(_M_X64)
+#error "The JIT currently only supports x86-64 hosts"
+#endif
+
+const uint32_t ARM_JIT_ID = 0x4A495400;
+
+// Worst case for a single instruction is well under 384 bytes
+#define ARM_JIT_MAX_BLOCK_CODE (ARM_JIT_MAX_BLOCK_LENGTH * 384 + 64)
+#define ARM_JIT_MAX_EXITS (ARM_JIT_MAX_BLOCK_LENGTH * 2)
+
+#define CPU_OFFSET(FIELD) ((int32_t) offsetof(struct ARMCore, FIELD))
+#define GPR_OFFSET(REG) (CPU_OFFSET(gprs) + (REG) * 4)
+
+// x86 寄存器编号
+enum {
+	X86_EAX = 0,
+	X86_ECX = 1,
+	X86_EDX = 2,
+	X86_EBX = 3,
+	X86_ESI = 6,
+	X86_EDI = 7
+};
+
+// 0x81 /n 立即数运算的扩展操作码
+enum {
+	X86_ALU_ADD = 0,
+	X86_ALU_OR = 1,
+	X86_ALU_AND = 4,
+	X86_ALU_SUB = 5,
+	X86_ALU_XOR = 6,
+	X86_ALU_CMP = 7
+};
+
+// 运算 r32, r/m32 的操作码
+enum {
+	X86_OP_ADD = 0x03,
+	X86_OP_OR = 0x0B,
+	X86_OP_AND = 0x23,
+	X86_OP_SUB = 0x2B,
+	X86_OP_XOR = 0x33
+};
+
+enum {
+	X86_CC_O = 0x0,
+	X86_CC_C = 0x2,
+	X86_CC_NC = 0x3,
+	X86_CC_Z = 0x4,
+	X86_CC_NZ = 0x5,
+	X86_CC_S = 0x8,
+	X86_CC_GE = 0xD
+};
+
+enum {
+	X86_SHIFT_SHL = 4,
+	X86_SHIFT_SHR = 5,
+	X86_SHIFT_SAR = 7
+};
+
+enum JITCarry {
+	JIT_CARRY_NONE = 0,
+	JIT_CARRY_X86,
+	JIT_CARRY_X86_INVERTED
+};
+
+#ifdef _WIN64
+#define X86_ARG0 X86_ECX
+#define X86_ARG1 X86_EDX
+#else
+#define X86_ARG0 X86_EDI
+#define X86_ARG1 X86_ESI
+#endif
+
+struct JITContext {
+	uint8_t* p;
+	uint8_t* exits[ARM_JIT_MAX_EXITS];
+	int nExits;
+};
+
+static void ARMJITInit(struct ARMCore* cpu, struct ARMComponent* component);
+static void ARMJITDeinit(struct ARMComponent* component);
+
+static inline void _emit8(struct JITContext* ctx, uint8_t value) {
+	*ctx->p = value;
+	++ctx->p;
+}
+
+static inline void _emit32(struct JITContext* ctx, uint32_t value) {
+	_emit8(ctx, value);
+	_emit8(ctx, value >> 8);
+	_emit8(ctx, value >> 16);
+	_emit8(ctx, value >> 24);
+}
+
+static inline void _emitModRM(struct JITContext* ctx, int mod, int reg, int rm) {
+	_emit8(ctx, (mod << 6) | (reg << 3) | rm);
+}
+
+// mov r32, [rbx + disp32]
+static void _emitLoad(struct JITContext* ctx, int reg, int32_t offset) {
+	_emit8(ctx, 0x8B);
+	_emitModRM(ctx, 2, reg, X86_EBX);
+	_emit32(ctx, offset);
+}
+
+// mov [rbx + disp32], r32
+static void _emitStore(struct JITContext* ctx, int32_t offset, int reg) {
+	_emit8(ctx, 0x89);
+	_emitModRM(ctx, 2, reg, X86_EBX);
+	_emit32(ctx, offset);
+}
+
+// mov dword [rbx + disp32], imm32
+static void _emitStoreImmediate(struct JITContext* ctx, int32_t offset, uint32_t value) {
+	_emit8(ctx, 0xC7);
+	_emitModRM(ctx, 2, 0, X86_EBX);
+	_emit32(ctx, offset);
+	_emit32(ctx, value);
+}
+
+// mov r32, imm32
+static void _emitMoveImmediate(struct JITContext* ctx, int reg, uint32_t value) {
+	_emit8(ctx, 0xB8 + reg);
+	_emit32(ctx, value);
+}
+
+// op r32, [rbx + disp32]
+static void _emitAluMemory(struct JITContext* ctx, int op, int reg, int32_t offset) {
+	_emit8(ctx, op);
+	_emitModRM(ctx, 2, reg, X86_EBX);
+	_emit32(ctx, offset);
+}
+
+// op r32, imm32
+static void _emitAluImmediate(struct JITContext* ctx, int op, int reg, uint32_t value) {
+	_emit8(ctx, 0x81);
+	_emitModRM(ctx, 3, op, reg);
+	_emit32(ctx, value);
+}
+
+// op dword [rbx + disp32], imm32
+static void _emitAluMemoryImmediate(struct JITContext* ctx, int op, int32_t offset, uint32_t value) {
+	_emit8(ctx, 0x81);
+	_emitModRM(ctx, 2, op, X86_EBX);
+	_emit32(ctx, offset);
+	_emit32(ctx, value);
+}
+
+// op r32, r32
+static void _emitAluRegister(struct JITContext* ctx, int op, int reg, int source) {
+	_emit8(ctx, op);
+	_emitModRM(ctx, 3, reg, source);
+}
+
+static void _emitMoveRegister(struct JITContext* ctx, int reg, int source) {
+	_emit8(ctx, 0x8B);
+	_emitModRM(ctx, 3, reg, source);
+}
+
+static void _emitNot(struct JITContext* ctx, int reg) {
+	_emit8(ctx, 0xF7);
+	_emitModRM(ctx, 3, 2, reg);
+}
+
+static void _emitShift(struct JITContext* ctx, int op, int reg, int immediate) {
+	_emit8(ctx, 0xC1);
+	_emitModRM(ctx, 3, op, reg);
+	_emit8(ctx, immediate);
+}
+
+// setcc dl; movzx edx, dl; lea ecx, [rcx + rdx * scale]
+static void _emitAccumulateFlag(struct JITContext* ctx, int cc, int scaleBits) {
+	_emit8(ctx, 0x0F);
+	_emit8(ctx, 0x90 | cc);
+	_emitModRM(ctx, 3, 0, X86_EDX);
+	_emit8(ctx, 0x0F);
+	_emit8(ctx, 0xB6);
+	_emitModRM(ctx, 3, X86_EDX, X86_EDX);
+	_emit8(ctx, 0x8D);
+	_emitModRM(ctx, 0, X86_ECX, 4);
+	_emit8(ctx, (scaleBits << 6) | (X86_EDX << 3) | X86_ECX);
+}
+
+static void _emitJump(struct JITContext* ctx, int cc) {
+	_emit8(ctx, 0x0F);
+	_emit8(ctx, 0x80 | cc);
+	_emit32(ctx, 0);
+}
+
+static void _emitExit(struct JITContext* ctx, int cc) {
+	_emitJump(ctx, cc);
+	ctx->exits[ctx->nExits] = ctx->p - 4;
+	++ctx->nExits;
+}
+
+static void _patchJump(uint8_t* rel, uint8_t* target) {
+	int32_t offset = target - (rel + 4);
+	rel[0] = offset;
+	rel[1] = offset >> 8;
+	rel[2] = offset >> 16;
+	rel[3] = offset >> 24;
+}
+
+static void _emitPrologue(struct JITContext* ctx) {
+	// push rbx; sub rsp, 32; mov rbx, arg0
+	_emit8(ctx, 0x53);
+	_emit8(ctx, 0x48);
+	_emit8(ctx, 0x83);
+	_emit8(ctx, 0xEC);
+	_emit8(ctx, 0x20);
+	_emit8(ctx, 0x48);
+	_emit8(ctx, 0x89);
+	_emitModRM(ctx, 3, X86_ARG0, X86_EBX);
+}
+
+static void _emitEpilogue(struct JITContext* ctx) {
+	// add rsp, 32; pop rbx; ret
+	_emit8(ctx, 0x48);
+	_emit8(ctx, 0x83);
+	_emit8(ctx, 0xC4);
+	_emit8(ctx, 0x20);
+	_emit8(ctx, 0x5B);
+	_emit8(ctx, 0xC3);
+}
+
+// 把x86的标志位写回cpsr，运算结果必须在eax中，且运算之后只执行过mov
+static void _emitFlags(struct JITContext* ctx, enum JITCarry carry, bool overflow) {
+	uint32_t mask = 0xC0000000;
+	_emitMoveImmediate(ctx, X86_ECX, 0);
+	if (overflow) {
+		_emitAccumulateFlag(ctx, X86_CC_O, 0);
+		mask |= 0x10000000;
+	}
+	switch (carry) {
+	case JIT_CARRY_NONE:
+		break;
+	case JIT_CARRY_X86:
+		_emitAccumulateFlag(ctx, X86_CC_C, 1);
+		mask |= 0x20000000;
+		break;
+	case JIT_CARRY_X86_INVERTED:
+		_emitAccumulateFlag(ctx, X86_CC_NC, 1);
+		mask |= 0x20000000;
+		break;
+	}
+	// test eax, eax
+	_emit8(ctx, 0x85);
+	_emitModRM(ctx, 3, X86_EAX, X86_EAX);
+	_emitAccumulateFlag(ctx, X86_CC_S, 3);
+	_emitAccumulateFlag(ctx, X86_CC_Z, 2);
+	_emitShift(ctx, X86_SHIFT_SHL, X86_ECX, 28);
+	_emitLoad(ctx, X86_EDX, CPU_OFFSET(cpsr));
+	_emitAluImmediate(ctx, X86_ALU_AND, X86_EDX, ~mask);
+	// or edx, ecx
+	_emit8(ctx, 0x09);
+	_emitModRM(ctx, 3, X86_ECX, X86_EDX);
+	_emitStore(ctx, CPU_OFFSET(cpsr), X86_EDX);
+}
+
+static void _emitPrefetchCycles(struct JITContext* ctx, enum ExecutionMode mode) {
+	if (mode == MODE_THUMB) {
+		_emitLoad(ctx, X86_EAX, CPU_OFFSET(memory.activeSeqCycles16));
+	} else {
+		_emitLoad(ctx, X86_EAX, CPU_OFFSET(memory.activeSeqCycles32));
+	}
+	_emitAluImmediate(ctx, X86_ALU_ADD, X86_EAX, 1);
+	// add [rbx + cycles], eax
+	_emit8(ctx, 0x01);
+	_emitModRM(ctx, 2, X86_EAX, X86_EBX);
+	_emit32(ctx, CPU_OFFSET(cycles));
+}
+
+static void _emitCall(struct JITContext* ctx, void* function, uint32_t opcode) {
+	// mov arg0, rbx
+	_emit8(ctx, 0x48);
+	_emit8(ctx, 0x89);
+	_emitModRM(ctx, 3, X86_EBX, X86_ARG0);
+	_emitMoveImmediate(ctx, X86_ARG1, opcode);
+	// mov rax, imm64; call rax
+	uint64_t address = (uintptr_t) function;
+	_emit8(ctx, 0x48);
+	_emit8(ctx, 0xB8);
+	_emit32(ctx, address);
+	_emit32(ctx, address >> 32);
+	_emit8(ctx, 0xFF);
+	_emitModRM(ctx, 3, 2, X86_EAX);
+}
+
+static void _emitConditionCheck(struct JITContext* ctx, unsigned condition) {
+	// 以NZCV为索引在真值表中查询：bt ecx, eax
+	_emitLoad(ctx, X86_EAX, CPU_OFFSET(cpsr));
+	_emitShift(ctx, X86_SHIFT_SHR, X86_EAX, 28);
+	_emitMoveImmediate(ctx, X86_ECX, _armConditionTable[condition]);
+	_emit8(ctx, 0x0F);
+	_emit8(ctx, 0xA3);
+	_emitModRM(ctx, 3, X86_EAX, X86_ECX);
+}
+
+static void _emitCycleCheck(struct JITContext* ctx) {
+	_emitLoad(ctx, X86_EAX, CPU_OFFSET(cycles));
+	_emitAluMemory(ctx, 0x3B, X86_EAX, CPU_OFFSET(nextEvent));
+	_emitExit(ctx, X86_CC_GE);
+}
+
+static bool _translateThumb(struct JITContext* ctx, const struct ARMInstructionInfo* info, uint32_t address) {
+	int rd = info->op1.reg;
+	int rn = info->op2.reg;
+	int format = info->operandFormat;
+	switch (info->mnemonic) {
+	case ARM_MN_MOV:
+		if (format & ARM_OPERAND_IMMEDIATE_2) {
+			_emitMoveImmediate(ctx, X86_EAX, info->op2.immediate);
+			_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+			_emitFlags(ctx, JIT_CARRY_NONE, false);
+			return true;
+		}
+		if (rd == ARM_PC || rn == ARM_PC) {
+			return false;
+		}
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+		return true;
+	case ARM_MN_CMP:
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rd));
+		if (format & ARM_OPERAND_IMMEDIATE_2) {
+			_emitAluImmediate(ctx, X86_ALU_SUB, X86_EAX, info->op2.immediate);
+		} else if (rd != ARM_PC && rn != ARM_PC) {
+			_emitAluMemory(ctx, X86_OP_SUB, X86_EAX, GPR_OFFSET(rn));
+		} else {
+			return false;
+		}
+		_emitFlags(ctx, JIT_CARRY_X86_INVERTED, true);
+		return true;
+	case ARM_MN_CMN:
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rd));
+		_emitAluMemory(ctx, X86_OP_ADD, X86_EAX, GPR_OFFSET(rn));
+		_emitFlags(ctx, JIT_CARRY_X86, true);
+		return true;
+	case ARM_MN_ADD:
+	case ARM_MN_SUB: {
+		int op = info->mnemonic == ARM_MN_ADD ? X86_ALU_ADD : X86_ALU_SUB;
+		int memOp = info->mnemonic == ARM_MN_ADD ? X86_OP_ADD : X86_OP_SUB;
+		if (!info->affectsCPSR) {
+			if (format & ARM_OPERAND_REGISTER_3) {
+				return false;
+			}
+			if (format & ARM_OPERAND_IMMEDIATE_3) {
+				// ADD Rd, PC/SP, #imm
+				if (rn == ARM_PC) {
+					_emitStoreImmediate(ctx, GPR_OFFSET(rd), ((address + WORD_SIZE_THUMB * 2) & 0xFFFFFFFC) + info->op3.immediate);
+					return true;
+				}
+				_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+				_emitAluImmediate(ctx, op, X86_EAX, info->op3.immediate);
+				_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+				return true;
+			}
+			if (format & ARM_OPERAND_IMMEDIATE_2) {
+				// ADD/SUB SP, #imm
+				_emitAluMemoryImmediate(ctx, op, GPR_OFFSET(rd), info->op2.immediate);
+				return true;
+			}
+			if (rd == ARM_PC || rn == ARM_PC) {
+				return false;
+			}
+			_emitLoad(ctx, X86_EAX, GPR_OFFSET(rd));
+			_emitAluMemory(ctx, memOp, X86_EAX, GPR_OFFSET(rn));
+			_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+			return true;
+		}
+		if (format & ARM_OPERAND_REGISTER_3) {
+			_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+			_emitAluMemory(ctx, memOp, X86_EAX, GPR_OFFSET(info->op3.reg));
+		} else if (format & ARM_OPERAND_IMMEDIATE_3) {
+			_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+			_emitAluImmediate(ctx, op, X86_EAX, info->op3.immediate);
+		} else {
+			_emitLoad(ctx, X86_EAX, GPR_OFFSET(rd));
+			_emitAluImmediate(ctx, op, X86_EAX, info->op2.immediate);
+		}
+		_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+		_emitFlags(ctx, info->mnemonic == ARM_MN_ADD ? JIT_CARRY_X86 : JIT_CARRY_X86_INVERTED, true);
+		return true;
+	}
+	case ARM_MN_NEG:
+		_emitMoveImmediate(ctx, X86_EAX, 0);
+		_emitAluMemory(ctx, X86_OP_SUB, X86_EAX, GPR_OFFSET(rn));
+		_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+		_emitFlags(ctx, JIT_CARRY_X86_INVERTED, true);
+		return true;
+	case ARM_MN_AND:
+	case ARM_MN_EOR:
+	case ARM_MN_ORR:
+	case ARM_MN_TST:
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rd));
+		switch (info->mnemonic) {
+		case ARM_MN_EOR:
+			_emitAluMemory(ctx, X86_OP_XOR, X86_EAX, GPR_OFFSET(rn));
+			break;
+		case ARM_MN_ORR:
+			_emitAluMemory(ctx, X86_OP_OR, X86_EAX, GPR_OFFSET(rn));
+			break;
+		default:
+			_emitAluMemory(ctx, X86_OP_AND, X86_EAX, GPR_OFFSET(rn));
+			break;
+		}
+		if (info->mnemonic != ARM_MN_TST) {
+			_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+		}
+		_emitFlags(ctx, JIT_CARRY_NONE, false);
+		return true;
+	case ARM_MN_BIC:
+	case ARM_MN_MVN:
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitNot(ctx, X86_EAX);
+		if (info->mnemonic == ARM_MN_BIC) {
+			_emitAluMemory(ctx, X86_OP_AND, X86_EAX, GPR_OFFSET(rd));
+		}
+		_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+		_emitFlags(ctx, JIT_CARRY_NONE, false);
+		return true;
+	case ARM_MN_LSL:
+	case ARM_MN_LSR:
+	case ARM_MN_ASR:
+		if (!(format & ARM_OPERAND_IMMEDIATE_3)) {
+			return false;
+		}
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		if (!info->op3.immediate) {
+			if (info->mnemonic != ARM_MN_LSL) {
+				// LSR #32 and ASR #32
+				return false;
+			}
+			_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+			_emitFlags(ctx, JIT_CARRY_NONE, false);
+			return true;
+		}
+		switch (info->mnemonic) {
+		case ARM_MN_LSL:
+			_emitShift(ctx, X86_SHIFT_SHL, X86_EAX, info->op3.immediate);
+			break;
+		case ARM_MN_LSR:
+			_emitShift(ctx, X86_SHIFT_SHR, X86_EAX, info->op3.immediate);
+			break;
+		default:
+			_emitShift(ctx, X86_SHIFT_SAR, X86_EAX, info->op3.immediate);
+			break;
+		}
+		_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+		_emitFlags(ctx, JIT_CARRY_X86, false);
+		return true;
+	case ARM_MN_BLH:
+		_emitStoreImmediate(ctx, GPR_OFFSET(ARM_LR), address + WORD_SIZE_THUMB * 2 + info->op1.immediate);
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+static bool _translateARM(struct JITContext* ctx, uint32_t opcode) {
+	// 只处理第二操作数为立即数或未移位寄存器的数据处理指令
+	if ((opcode & 0x0C000000) || (!(opcode & 0x02000000) && (opcode & 0x00000FF0))) {
+		return false;
+	}
+	int aluOp = (opcode >> 21) & 0xF;
+	bool s = opcode & 0x00100000;
+	int rn = (opcode >> 16) & 0xF;
+	int rd = (opcode >> 12) & 0xF;
+	int rm = opcode & 0xF;
+	bool writesRd = aluOp < 0x8 || aluOp > 0xB;
+	bool readsRn = aluOp != 0xD && aluOp != 0xF;
+	if (!writesRd && !s) {
+		// MRS, MSR and BX live here
+		return false;
+	}
+	if (aluOp >= 0x5 && aluOp <= 0x7) {
+		// ADC, SBC and RSC need the incoming carry
+		return false;
+	}
+	if (rd == ARM_PC || (readsRn && rn == ARM_PC) || (!(opcode & 0x02000000) && rm == ARM_PC)) {
+		return false;
+	}
+
+	// 第二操作数放在ecx中，运算结果放在eax中
+	// 乘法指令的S标志会读取cpu->shifterCarryOut，所以仍需更新该值
+	int carryOut = -1;
+	if (opcode & 0x02000000) {
+		int rotate = (opcode & 0x00000F00) >> 7;
+		uint32_t immediate = ARM_ROR(opcode & 0x000000FF, rotate);
+		if (rotate) {
+			carryOut = ARM_SIGN(immediate) ? 1 : 0;
+		}
+		_emitMoveImmediate(ctx, X86_ECX, immediate);
+	} else {
+		_emitLoad(ctx, X86_ECX, GPR_OFFSET(rm));
+	}
+	if (carryOut >= 0) {
+		_emitStoreImmediate(ctx, CPU_OFFSET(shifterCarryOut), carryOut);
+	} else {
+		_emitLoad(ctx, X86_EDX, CPU_OFFSET(cpsr));
+		_emitShift(ctx, X86_SHIFT_SHR, X86_EDX, 29);
+		_emitAluImmediate(ctx, X86_ALU_AND, X86_EDX, 1);
+		_emitStore(ctx, CPU_OFFSET(shifterCarryOut), X86_EDX);
+	}
+
+	enum JITCarry carry = JIT_CARRY_NONE;
+	bool overflow = false;
+	switch (aluOp) {
+	case 0x0: // AND
+	case 0x8: // TST
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitAluRegister(ctx, X86_OP_AND, X86_EAX, X86_ECX);
+		break;
+	case 0x1: // EOR
+	case 0x9: // TEQ
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitAluRegister(ctx, X86_OP_XOR, X86_EAX, X86_ECX);
+		break;
+	case 0x2: // SUB
+	case 0xA: // CMP
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitAluRegister(ctx, X86_OP_SUB, X86_EAX, X86_ECX);
+		carry = JIT_CARRY_X86_INVERTED;
+		overflow = true;
+		break;
+	case 0x3: // RSB
+		_emitMoveRegister(ctx, X86_EAX, X86_ECX);
+		_emitAluMemory(ctx, X86_OP_SUB, X86_EAX, GPR_OFFSET(rn));
+		carry = JIT_CARRY_X86_INVERTED;
+		overflow = true;
+		break;
+	case 0x4: // ADD
+	case 0xB: // CMN
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitAluRegister(ctx, X86_OP_ADD, X86_EAX, X86_ECX);
+		carry = JIT_CARRY_X86;
+		overflow = true;
+		break;
+	case 0xC: // ORR
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitAluRegister(ctx, X86_OP_OR, X86_EAX, X86_ECX);
+		break;
+	case 0xD: // MOV
+		_emitMoveRegister(ctx, X86_EAX, X86_ECX);
+		break;
+	case 0xE: // BIC
+		_emitNot(ctx, X86_ECX);
+		_emitLoad(ctx, X86_EAX, GPR_OFFSET(rn));
+		_emitAluRegister(ctx, X86_OP_AND, X86_EAX, X86_ECX);
+		break;
+	case 0xF: // MVN
+		_emitMoveRegister(ctx, X86_EAX, X86_ECX);
+		_emitNot(ctx, X86_EAX);
+		break;
+	}
+	if (writesRd) {
+		_emitStore(ctx, GPR_OFFSET(rd), X86_EAX);
+	}
+	if (s) {
+		_emitFlags(ctx, carry, overflow);
+		// 逻辑运算的C标志来自移位器，循环移位的立即数在翻译时就已经确定
+		if (carry == JIT_CARRY_NONE && carryOut == 1) {
+			_emitAluMemoryImmediate(ctx, X86_ALU_OR, CPU_OFFSET(cpsr), 0x20000000);
+		} else if (carry == JIT_CARRY_NONE && carryOut == 0) {
+			_emitAluMemoryImmediate(ctx, X86_ALU_AND, CPU_OFFSET(cpsr), ~0x20000000);
+		}
+	}
+	return true;
+}
+
+static const struct ARMJITRange* _findRange(struct ARMJIT* jit, uint32_t address, int width) {
+	int i;
+	for (i = 0; i < jit->nStaticRanges; ++i) {
+		if (address >= jit->staticRanges[i].start && address < jit->staticRanges[i].end && jit->staticRanges[i].end - address >= (uint32_t) width) {
+			return &jit->staticRanges[i];
+		}
+	}
+	return 0;
+}
+
+static inline uint32_t _fetch(struct ARMCore* cpu, uint32_t address, enum ExecutionMode mode) {
+	uint32_t opcode;
+	if (mode == MODE_THUMB) {
+		uint16_t halfword;
+		LOAD_16(halfword, address & cpu->memory.activeMask, cpu->memory.activeRegion);
+		opcode = halfword;
+	} else {
+		LOAD_32(opcode, address & cpu->memory.activeMask, cpu->memory.activeRegion);
+	}
+	return opcode;
+}
+
+static struct ARMJITBlock* _translateBlock(struct ARMJIT* jit, const struct ARMJITRange* range, uint32_t address, enum ExecutionMode mode) {
+	struct ARMCore* cpu = jit->cpu;
+	if (jit->nBlocks >= ARM_JIT_MAX_BLOCKS || jit->codeUsed + ARM_JIT_MAX_BLOCK_CODE > ARM_JIT_CODE_SIZE) {
+		ARMJITFlush(jit);
+	}
+
+	struct JITContext ctx;
+	ctx.p = &jit->code[jit->codeUsed];
+	ctx.nExits = 0;
+	uint8_t* entry = ctx.p;
+	_emitPrologue(&ctx);
+
+	int width = mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	uint32_t pc = address;
+	int i;
+	for (i = 0; i < ARM_JIT_MAX_BLOCK_LENGTH; ++i) {
+		uint32_t opcode = _fetch(cpu, pc, mode);
+		struct ARMInstructionInfo info;
+		if (mode == MODE_THUMB) {
+			ARMDecodeThumb(opcode, &info);
+		} else {
+			ARMDecodeARM(opcode, &info);
+		}
+		bool last = info.branchType != ARM_BRANCH_NONE || info.traps ||
+			i + 1 == ARM_JIT_MAX_BLOCK_LENGTH || range->end - pc < (uint32_t) width * 2;
+
+		// 与解释器执行该指令时的状态保持一致：PC指向当前指令+2条指令，prefetch为下一条指令
+		_emitStoreImmediate(&ctx, GPR_OFFSET(ARM_PC), pc + width * 2);
+		_emitStoreImmediate(&ctx, CPU_OFFSET(prefetch), _fetch(cpu, pc + width, mode));
+
+		uint8_t* skip = 0;
+		unsigned condition = opcode >> 28;
+		if (mode == MODE_ARM && condition != 0xE) {
+			_emitConditionCheck(&ctx, condition);
+			_emitJump(&ctx, X86_CC_NC);
+			skip = ctx.p - 4;
+		}
+
+		bool native;
+		if (mode == MODE_THUMB) {
+			native = _translateThumb(&ctx, &info, pc);
+		} else {
+			native = _translateARM(&ctx, opcode);
+		}
+		if (native) {
+			_emitPrefetchCycles(&ctx, mode);
+		} else if (mode == MODE_THUMB) {
+			_emitCall(&ctx, _thumbTable[opcode >> 6], opcode);
+		} else {
+			_emitCall(&ctx, _armTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)], opcode);
+		}
+
+		if (skip) {
+			// jmp rel32 跳过条件不成立时的分支
+			_emit8(&ctx, 0xE9);
+			_emit32(&ctx, 0);
+			uint8_t* join = ctx.p - 4;
+			_patchJump(skip, ctx.p);
+			_emitPrefetchCycles(&ctx, mode);
+			_patchJump(join, ctx.p);
+		}
+
+		if (last) {
+			break;
+		}
+		if (!native) {
+			// 解释器函数可能改写了PC
+			_emitAluMemoryImmediate(&ctx, X86_ALU_CMP, GPR_OFFSET(ARM_PC), pc + width * 2);
+			_emitExit(&ctx, X86_CC_NZ);
+		}
+		_emitCycleCheck(&ctx);
+		pc += width;
+	}
+
+	for (i = 0; i < ctx.nExits; ++i) {
+		_patchJump(ctx.exits[i], ctx.p);
+	}
+	_emitEpilogue(&ctx);
+	jit->codeUsed = ((ctx.p - jit->code) + 15) & ~15;
+
+	struct ARMJITBlock* block = &jit->blocks[jit->nBlocks];
+	++jit->nBlocks;
+	block->address = address;
+	block->mode = mode;
+	block->opcode = _fetch(cpu, address, mode);
+	block->region = cpu->memory.activeRegion;
+	block->entry = (void (*)(struct ARMCore*)) entry;
+	struct ARMJITBlock** bucket = &jit->table[(address >> 1) & ((1 << ARM_JIT_HASH_BITS) - 1)];
+	block->next = *bucket;
+	*bucket = block;
+	return block;
+}
+
+void ARMJITCreate(struct ARMJIT* jit) {
+	jit->d.id = ARM_JIT_ID;
+	jit->d.init = ARMJITInit;
+	jit->d.deinit = ARMJITDeinit;
+	jit->cpu = 0;
+	jit->code = 0;
+	jit->blocks = 0;
+	jit->table = 0;
+	jit->nStaticRanges = 0;
+}
+
+static void ARMJITInit(struct ARMCore* cpu, struct ARMComponent* component) {
+	struct ARMJIT* jit = (struct ARMJIT*) component;
+	jit->cpu = cpu;
+	jit->code = executableMemoryMap(ARM_JIT_CODE_SIZE);
+	jit->blocks = malloc(sizeof(struct ARMJITBlock) * ARM_JIT_MAX_BLOCKS);
+	jit->table = calloc(1 << ARM_JIT_HASH_BITS, sizeof(struct ARMJITBlock*));
+	jit->codeUsed = 0;
+	jit->nBlocks = 0;
+	// 禁止可写可执行映射的系统上代码区会分配失败，此时code为0，GBAAttachJIT不会挂上JIT
+	if (!jit->code || !jit->blocks || !jit->table) {
+		ARMJITDeinit(component);
+	}
+}
+
+static void ARMJITDeinit(struct ARMComponent* component) {
+	struct ARMJIT* jit = (struct ARMJIT*) component;
+	if (jit->code) {
+		mappedMemoryFree(jit->code, ARM_JIT_CODE_SIZE);
+	}
+	free(jit->blocks);
+	free(jit->table);
+	jit->code = 0;
+	jit->blocks = 0;
+	jit->table = 0;
+}
+
+void ARMJITAddStaticRange(struct ARMJIT* jit, uint32_t start, uint32_t end, const void* region) {
+	if (jit->nStaticRanges >= ARM_JIT_MAX_STATIC_RANGES) {
+		return;
+	}
+	jit->staticRanges[jit->nStaticRanges].start = start;
+	jit->staticRanges[jit->nStaticRanges].end = end;
+	jit->staticRanges[jit->nStaticRanges].region = region;
+	++jit->nStaticRanges;
+}
+
+void ARMJITFlush(struct ARMJIT* jit) {
+	jit->codeUsed = 0;
+	jit->nBlocks = 0;
+	memset(jit->table, 0, sizeof(struct ARMJITBlock*) << ARM_JIT_HASH_BITS);
+}
+
+void ARMJITRunLoop(struct ARMJIT* jit) {
+	struct ARMCore* cpu = jit->cpu;
+	while (cpu->cycles < cpu->nextEvent) {
+		enum ExecutionMode mode = cpu->executionMode;
+		int width = mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+		uint32_t address = cpu->gprs[ARM_PC] - width;
+		struct ARMJITBlock* block = jit->table[(address >> 1) & ((1 << ARM_JIT_HASH_BITS) - 1)];
+		while (block && (block->address != address || block->mode != mode)) {
+			block = block->next;
+		}
+		if (!block) {
+			const struct ARMJITRange* range = _findRange(jit, address, width);
+			if (!range || range->region != cpu->memory.activeRegion) {
+				// 可写内存中的代码交给解释器执行
+				ARMStepInstruction(cpu);
+				continue;
+			}
+			block = _translateBlock(jit, range, address, mode);
+		}
+		if (block->opcode != cpu->prefetch || block->region != cpu->memory.activeRegion) {
+			// 写回PC或顺序执行跨越内存区域时，解释器取到的指令可能与翻译时不一致
+			ARMStepInstruction(cpu);
+			continue;
+		}
+		block->entry(cpu);
+	}
+	cpu->irqh.processEvents(cpu);
+}
@@ -0,0 +1,62 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef ARM_JIT_H
+#define ARM_JIT_H
+
+#include "util/common.h"
+
+#include "arm.h"
+
+/*
+x86-64动态重编译器（JIT）
+只翻译不可写的代码区域（BIOS、卡带ROM），因此已翻译的块永远不需要失效
+常见的数据处理指令直接生成本机代码，其余指令生成对_armTable/_thumbTable中解释器函数的直接调用
+每条指令执行后都检查cpu->cycles >= cpu->nextEvent，时钟周期与解释器完全一致
+*/
+
+extern const uint32_t ARM_JIT_ID;
+
+#define ARM_JIT_CODE_SIZE 0x00800000
+#define ARM_JIT_MAX_BLOCKS 0x00010000
+#define ARM_JIT_MAX_BLOCK_LENGTH 64
+#define ARM_JIT_HASH_BITS 14
+#define ARM_JIT_MAX_STATIC_RANGES 4
+
+struct ARMJITBlock {
+	struct ARMJITBlock* next;	//同一哈希桶中的下一个块
+	uint32_t address;			//块中第一条指令的地址
+	enum ExecutionMode mode;
+	uint32_t opcode;			//第一条指令，进入块之前与prefetch比较
+	const uint32_t* region;		//翻译时的cpu->memory.activeRegion
+	void (*entry)(struct ARMCore* cpu);
+};
+
+struct ARMJITRange {
+	uint32_t start;
+	uint32_t end;
+	const uint32_t* region;		//该地址范围对应的cpu->memory.activeRegion
+};
+
+struct ARMJIT {
+	struct ARMComponent d;
+	struct ARMCore* cpu;
+
+	uint8_t* code;
+	size_t codeUsed;
+	struct ARMJITBlock* blocks;
+	int nBlocks;
+	struct ARMJITBlock** table;
+
+	struct ARMJITRange staticRanges[ARM_JIT_MAX_STATIC_RANGES];
+	int nStaticRanges;
+};
+
+void ARMJITCreate(struct ARMJIT* jit);
+void ARMJITAddStaticRange(struct ARMJIT* jit, uint32_t start, uint32_t end, const void* region);
+void ARMJITFlush(struct ARMJIT* jit);
+void ARMJITRunLoop(struct ARMJIT* jit);
+
+#endif
@@ -0,0 +1,242 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "profiler.h"
+
+#include "util/vfs.h"
+
+#include <stdarg.h>
+
+const uint32_t ARM_PROFILER_ID = 0x50524F46;
+
+#define FUNCTION_TABLE_SIZE 0x400
+#define COST_TABLE_SIZE 0x2000
+
+static void ARMProfilerInit(struct ARMCore* cpu, struct ARMComponent* component);
+static void ARMProfilerDeinit(struct ARMComponent* component);
+
+static void _freeFunction(void* value) {
+	struct ARMProfilerFunction* function = value;
+	struct ARMProfilerCall* call = function->calls;
+	while (call) {
+		struct ARMProfilerCall* next = call->next;
+		free(call);
+		call = next;
+	}
+	free(function);
+}
+
+static void _freeCosts(void* value) {
+	struct ARMProfilerCost* cost = value;
+	while (cost) {
+		struct ARMProfilerCost* next = cost->next;
+		free(cost);
+		cost = next;
+	}
+}
+
+// 地址至少按半字对齐，去掉最低位后再做键，避免哈希桶只用到一半
+static struct ARMProfilerFunction* _lookupFunction(struct ARMProfiler* profiler, uint32_t address) {
+	struct ARMProfilerFunction* function = TableLookup(&profiler->functions, address >> 1);
+	if (!function) {
+		function = malloc(sizeof(*function));
+		function->address = address;
+		function->calls = 0;
+		TableInsert(&profiler->functions, address >> 1, function);
+	}
+	return function;
+}
+
+static void _addCost(struct ARMProfiler* profiler, uint32_t address, int32_t cycles) {
+	struct ARMProfilerFunction* function = profiler->stack[profiler->depth - 1].function;
+	struct ARMProfilerCost* head = TableLookup(&profiler->costs, address >> 1);
+	struct ARMProfilerCost* cost;
+	for (cost = head; cost && cost->function != function; cost = cost->next);
+	if (!cost) {
+		cost = malloc(sizeof(*cost));
+		cost->function = function;
+		cost->address = address;
+		cost->cycles = 0;
+		cost->instructions = 0;
+		if (head) {
+			cost->next = head->next;
+			head->next = cost;
+		} else {
+			cost->next = 0;
+			TableInsert(&profiler->costs, address >> 1, cost);
+		}
+	}
+	cost->cycles += cycles;
+	++cost->instructions;
+	profiler->totalCycles += cycles;
+	++profiler->totalInstructions;
+}
+
+static void _enter(struct ARMProfiler* profiler, uint32_t site, uint32_t target, uint32_t returnAddress) {
+	if (profiler->depth == ARM_PROFILER_MAX_DEPTH) {
+		// 栈溢出时（通常是递归过深或从不返回的调用）不再压栈，开销记在调用者身上
+		return;
+	}
+	struct ARMProfilerFrame* caller = &profiler->stack[profiler->depth - 1];
+	struct ARMProfilerFunction* callee = _lookupFunction(profiler, target);
+	struct ARMProfilerCall* call;
+	for (call = caller->function->calls; call && (call->callee != callee || call->site != site); call = call->next);
+	if (!call) {
+		call = malloc(sizeof(*call));
+		call->callee = callee;
+		call->site = site;
+		call->count = 0;
+		call->inclusiveCycles = 0;
+		call->inclusiveInstructions = 0;
+		call->next = caller->function->calls;
+		caller->function->calls = call;
+	}
+	++call->count;
+
+	struct ARMProfilerFrame* frame = &profiler->stack[profiler->depth];
+	frame->function = callee;
+	frame->call = call;
+	frame->returnAddress = returnAddress;
+	frame->cyclesAtEntry = profiler->totalCycles;
+	frame->instructionsAtEntry = profiler->totalInstructions;
+	++profiler->depth;
+}
+
+static void _leave(struct ARMProfiler* profiler, int depth) {
+	while (profiler->depth > depth) {
+		--profiler->depth;
+		struct ARMProfilerFrame* frame = &profiler->stack[profiler->depth];
+		if (frame->call) {
+			frame->call->inclusiveCycles += profiler->totalCycles - frame->cyclesAtEntry;
+			frame->call->inclusiveInstructions += profiler->totalInstructions - frame->instructionsAtEntry;
+		}
+	}
+}
+
+static void _branch(struct ARMProfiler* profiler, uint32_t site, uint32_t target, uint32_t next) {
+	struct ARMCore* cpu = profiler->cpu;
+	int i;
+	for (i = profiler->depth - 1; i > 0; --i) {
+		if (profiler->stack[i].returnAddress == target) {
+			_leave(profiler, i);
+			return;
+		}
+	}
+	if (((uint32_t) cpu->gprs[ARM_LR] & ~1) == next) {
+		_enter(profiler, site, target, next);
+	}
+}
+
+void ARMProfilerCreate(struct ARMProfiler* profiler, struct VFile* output) {
+	profiler->d.id = ARM_PROFILER_ID;
+	profiler->d.init = ARMProfilerInit;
+	profiler->d.deinit = ARMProfilerDeinit;
+	profiler->cpu = 0;
+	profiler->output = output;
+}
+
+static void ARMProfilerInit(struct ARMCore* cpu, struct ARMComponent* component) {
+	struct ARMProfiler* profiler = (struct ARMProfiler*) component;
+	profiler->cpu = cpu;
+	TableInit(&profiler->functions, FUNCTION_TABLE_SIZE, _freeFunction);
+	TableInit(&profiler->costs, COST_TABLE_SIZE, _freeCosts);
+	profiler->depth = 0;
+	profiler->totalCycles = 0;
+	profiler->totalInstructions = 0;
+}
+
+static void _writef(struct VFile* vf, const char* format, ...) {
+	char line[128];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (length > 0) {
+		vf->write(vf, line, (size_t) length < sizeof(line) ? (size_t) length : sizeof(line) - 1);
+	}
+}
+
+struct ARMProfilerWriter {
+	struct VFile* vf;
+	struct ARMProfilerFunction* function;
+};
+
+static void _writeCosts(void* value, void* user) {
+	struct ARMProfilerWriter* writer = user;
+	struct ARMProfilerCost* cost;
+	for (cost = value; cost; cost = cost->next) {
+		if (cost->function != writer->function) {
+			writer->function = cost->function;
+			_writef(writer->vf, "fn=0x%08X\n", cost->function->address);
+		}
+		_writef(writer->vf, "0x%08X %llu %llu\n", cost->address, (unsigned long long) cost->cycles, (unsigned long long) cost->instructions);
+	}
+}
+
+static void _writeCalls(void* value, void* user) {
+	struct ARMProfilerWriter* writer = user;
+	struct ARMProfilerFunction* function = value;
+	struct ARMProfilerCall* call;
+	for (call = function->calls; call; call = call->next) {
+		if (function != writer->function) {
+			writer->function = function;
+			_writef(writer->vf, "fn=0x%08X\n", function->address);
+		}
+		_writef(writer->vf, "cfn=0x%08X\n", call->callee->address);
+		_writef(writer->vf, "calls=%llu 0x%08X\n", (unsigned long long) call->count, call->callee->address);
+		_writef(writer->vf, "0x%08X %llu %llu\n", call->site, (unsigned long long) call->inclusiveCycles, (unsigned long long) call->inclusiveInstructions);
+	}
+}
+
+static void ARMProfilerDeinit(struct ARMComponent* component) {
+	struct ARMProfiler* profiler = (struct ARMProfiler*) component;
+	_leave(profiler, 0);
+	if (profiler->output) {
+		struct ARMProfilerWriter writer = { profiler->output, 0 };
+		_writef(writer.vf, "version: 1\ncreator: mGBA\npositions: instr\nevents: Cycles Instructions\n");
+		_writef(writer.vf, "summary: %llu %llu\n\n", (unsigned long long) profiler->totalCycles, (unsigned long long) profiler->totalInstructions);
+		TableEnumerate(&profiler->costs, _writeCosts, &writer);
+		TableEnumerate(&profiler->functions, _writeCalls, &writer);
+		profiler->output->close(profiler->output);
+		profiler->output = 0;
+	}
+	TableDeinit(&profiler->costs);
+	TableDeinit(&profiler->functions);
+}
+
+void ARMProfilerRunLoop(struct ARMProfiler* profiler) {
+	struct ARMCore* cpu = profiler->cpu;
+	int width = cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	if (!profiler->depth) {
+		// 最外层的帧是开始分析时所在的函数，永远不会弹出
+		struct ARMProfilerFrame* frame = &profiler->stack[0];
+		frame->function = _lookupFunction(profiler, cpu->gprs[ARM_PC] - width);
+		frame->call = 0;
+		frame->returnAddress = 0;
+		frame->cyclesAtEntry = profiler->totalCycles;
+		frame->instructionsAtEntry = profiler->totalInstructions;
+		profiler->depth = 1;
+	}
+	while (cpu->cycles < cpu->nextEvent) {
+		uint32_t address = cpu->gprs[ARM_PC] - width;
+		int32_t cycles = cpu->cycles;
+		ARMStepInstruction(cpu);
+		_addCost(profiler, address, cpu->cycles - cycles);
+		uint32_t next = address + width;
+		width = cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+		uint32_t target = cpu->gprs[ARM_PC] - width;
+		if (target != next) {
+			_branch(profiler, address, target, next);
+		}
+	}
+	uint32_t interrupted = cpu->gprs[ARM_PC] - width;
+	cpu->irqh.processEvents(cpu);
+	width = cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	uint32_t target = cpu->gprs[ARM_PC] - width;
+	if (target != interrupted) {
+		// 处理事件时进入了中断，中断返回时回到被打断的指令
+		_enter(profiler, interrupted, target, interrupted);
+	}
+}
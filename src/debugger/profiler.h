@@ -0,0 +1,76 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "util/common.h"
+
+#include "arm.h"
+#include "util/table.h"
+
+/*
+按PC统计的性能分析器
+逐条执行指令，把每条指令消耗的周期数记到当前函数的该PC上
+根据LR是否指向下一条指令识别函数调用（BL、BX前的MOV LR等），根据影子栈中的返回地址识别返回，中断入口也当作一次调用
+退出时以callgrind格式写出，可用kcachegrind等工具查看
+*/
+
+extern const uint32_t ARM_PROFILER_ID;
+
+#define ARM_PROFILER_MAX_DEPTH 256
+
+struct VFile;
+struct ARMProfilerFunction;
+
+struct ARMProfilerCost {
+	struct ARMProfilerCost* next;	//同一PC在其他函数中的开销
+	struct ARMProfilerFunction* function;
+	uint32_t address;
+	uint64_t cycles;
+	uint64_t instructions;
+};
+
+struct ARMProfilerCall {
+	struct ARMProfilerCall* next;
+	struct ARMProfilerFunction* callee;
+	uint32_t site;		//调用指令的地址
+	uint64_t count;
+	uint64_t inclusiveCycles;
+	uint64_t inclusiveInstructions;
+};
+
+struct ARMProfilerFunction {
+	uint32_t address;
+	struct ARMProfilerCall* calls;
+};
+
+struct ARMProfilerFrame {
+	struct ARMProfilerFunction* function;
+	struct ARMProfilerCall* call;	//调用者中对应的调用记录，最外层为0
+	uint32_t returnAddress;
+	uint64_t cyclesAtEntry;
+	uint64_t instructionsAtEntry;
+};
+
+struct ARMProfiler {
+	struct ARMComponent d;
+	struct ARMCore* cpu;
+	struct VFile* output;
+
+	struct Table functions;
+	struct Table costs;
+
+	struct ARMProfilerFrame stack[ARM_PROFILER_MAX_DEPTH];
+	int depth;
+
+	uint64_t totalCycles;
+	uint64_t totalInstructions;
+};
+
+void ARMProfilerCreate(struct ARMProfiler* profiler, struct VFile* output);
+void ARMProfilerRunLoop(struct ARMProfiler* profiler);
+
+#endif
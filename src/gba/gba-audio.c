@@ -13,6 +13,8 @@
 
 const unsigned GBA_AUDIO_SAMPLES = 2048;
 const unsigned GBA_AUDIO_FIFO_SIZE = 8 * sizeof(int32_t);
+static const float GBA_AUDIO_RATE_CONTROL_DELTA = 0.005f;
+static const float GBA_AUDIO_RATE_CONTROL_WINDOW = 0.125f;
 #define SWEEP_CYCLES (GBA_ARM7TDMI_FREQUENCY / 128)
 
 static bool _writeEnvelope(struct GBAAudioEnvelope* envelope, uint16_t value);
@@ -24,11 +26,12 @@ static int32_t _updateChannel2(struct GBAAudioChannel2* ch);
 static int32_t _updateChannel3(struct GBAAudioChannel3* ch);
 static int32_t _updateChannel4(struct GBAAudioChannel4* ch);
 static int _applyBias(struct GBAAudio* audio, int sample);
+static void _renderPSG(struct GBAAudio* audio);
+static void _flushPSG(struct GBAAudio* audio);
 static void _sample(struct GBAAudio* audio);
 
 void GBAAudioInit(struct GBAAudio* audio, size_t samples) {
-	CircleBufferInit(&audio->left, samples * sizeof(int32_t));
-	CircleBufferInit(&audio->right, samples * sizeof(int32_t));
+	AudioRingInit(&audio->buffer, samples);
 	CircleBufferInit(&audio->chA.fifo, GBA_AUDIO_FIFO_SIZE);
 	CircleBufferInit(&audio->chB.fifo, GBA_AUDIO_FIFO_SIZE);
 }
@@ -49,6 +52,7 @@ void GBAAudioReset(struct GBAAudio* audio) {
 	audio->chB.sample = 0;
 	audio->eventDiff = 0;
 	audio->nextSample = 0;
+	audio->streamSamples = 0;
 	audio->sampleRate = 0x8000;
 	audio->soundbias = 0x200;
 	audio->volumeRight = 0;
@@ -77,183 +81,42 @@ void GBAAudioReset(struct GBAAudio* audio) {
 	audio->enable = false;
 	audio->sampleInterval = GBA_ARM7TDMI_FREQUENCY / audio->sampleRate;
 
-	CircleBufferClear(&audio->left);
-	CircleBufferClear(&audio->right);
+	AudioRingClear(&audio->buffer);
 	CircleBufferClear(&audio->chA.fifo);
 	CircleBufferClear(&audio->chB.fifo);
 }
 
 void GBAAudioDeinit(struct GBAAudio* audio) {
-	CircleBufferDeinit(&audio->left);
-	CircleBufferDeinit(&audio->right);
+	AudioRingDeinit(&audio->buffer);
 	CircleBufferDeinit(&audio->chA.fifo);
 	CircleBufferDeinit(&audio->chB.fifo);
 }
 
+// 生产者此时不在运行（模拟线程自己调用或已被中断），加锁只是为了排除消费者
+// 开启速率控制时缓冲区加倍，生产者等待的半满处仍是samples，延迟不变
 void GBAAudioResizeBuffer(struct GBAAudio* audio, size_t samples) {
-	GBASyncLockAudio(audio->p->sync);
-	size_t oldCapacity = audio->left.capacity;
-	int32_t* buffer = malloc(oldCapacity);
-	int32_t dummy;
-	size_t read;
-	size_t i;
-
-	read = CircleBufferDump(&audio->left, buffer, oldCapacity);
-	CircleBufferDeinit(&audio->left);
-	CircleBufferInit(&audio->left, samples * sizeof(int32_t));
-	for (i = 0; i * sizeof(int32_t) < read; ++i) {
-		if (!CircleBufferWrite32(&audio->left, buffer[i])) {
-			CircleBufferRead32(&audio->left, &dummy);
-			CircleBufferWrite32(&audio->left, buffer[i]);
-		}
-	}
-
-	read = CircleBufferDump(&audio->right, buffer, oldCapacity);
-	CircleBufferDeinit(&audio->right);
-	CircleBufferInit(&audio->right, samples * sizeof(int32_t));
-	for (i = 0; i * sizeof(int32_t) < read; ++i) {
-		if (!CircleBufferWrite32(&audio->right, buffer[i])) {
-			CircleBufferRead32(&audio->right, &dummy);
-			CircleBufferWrite32(&audio->right, buffer[i]);
-		}
+	if (audio->p->sync->audioRateControl) {
+		samples *= 2;
 	}
-
-	free(buffer);
-
+	GBASyncLockAudio(audio->p->sync);
+	AudioRingResize(&audio->buffer, samples);
 	GBASyncConsumeAudio(audio->p->sync);
 }
 
+/*
+音频事件只在取样时刻触发。PSG通道的包络、扫频、波形和长度计时不再各自作为事件调度，
+而是在取样或写入寄存器前由_renderPSG一次推进到当前时刻，期间的步进在各通道的循环里按时间顺序处理
+*/
 int32_t GBAAudioProcessEvents(struct GBAAudio* audio, int32_t cycles) {
 	audio->nextEvent -= cycles;
 	audio->eventDiff += cycles;
 	if (audio->nextEvent <= 0) {
-		audio->nextEvent = INT_MAX;
-		if (audio->enable) {
-			if (audio->playingCh1 && !audio->ch1.envelope.dead) {
-				audio->nextCh1 -= audio->eventDiff;
-				if (audio->ch1.envelope.nextStep != INT_MAX) {
-					audio->ch1.envelope.nextStep -= audio->eventDiff;
-					if (audio->ch1.envelope.nextStep <= 0) {
-						int8_t sample = audio->ch1.control.hi * 0x10 - 0x8;
-						_updateEnvelope(&audio->ch1.envelope);
-						if (audio->ch1.envelope.nextStep < audio->nextEvent) {
-							audio->nextEvent = audio->ch1.envelope.nextStep;
-						}
-						audio->ch1.sample = sample * audio->ch1.envelope.currentVolume;
-					}
-				}
-
-				if (audio->ch1.nextSweep != INT_MAX) {
-					audio->ch1.nextSweep -= audio->eventDiff;
-					if (audio->ch1.nextSweep <= 0) {
-						audio->playingCh1 = _updateSweep(&audio->ch1);
-						if (audio->ch1.nextSweep < audio->nextEvent) {
-							audio->nextEvent = audio->ch1.nextSweep;
-						}
-					}
-				}
-
-				if (audio->nextCh1 <= 0) {
-					audio->nextCh1 += _updateChannel1(&audio->ch1);
-					if (audio->nextCh1 < audio->nextEvent) {
-						audio->nextEvent = audio->nextCh1;
-					}
-				}
-
-				if (audio->ch1.control.stop) {
-					audio->ch1.control.endTime -= audio->eventDiff;
-					if (audio->ch1.control.endTime <= 0) {
-						audio->playingCh1 = 0;
-					}
-				}
-			}
-
-			if (audio->playingCh2 && !audio->ch2.envelope.dead) {
-				audio->nextCh2 -= audio->eventDiff;
-				if (audio->ch2.envelope.nextStep != INT_MAX) {
-					audio->ch2.envelope.nextStep -= audio->eventDiff;
-					if (audio->ch2.envelope.nextStep <= 0) {
-						int8_t sample = audio->ch2.control.hi * 0x10 - 0x8;
-						_updateEnvelope(&audio->ch2.envelope);
-						if (audio->ch2.envelope.nextStep < audio->nextEvent) {
-							audio->nextEvent = audio->ch2.envelope.nextStep;
-						}
-						audio->ch2.sample = sample * audio->ch2.envelope.currentVolume;
-					}
-				}
-
-				if (audio->nextCh2 <= 0) {
-					audio->nextCh2 += _updateChannel2(&audio->ch2);
-					if (audio->nextCh2 < audio->nextEvent) {
-						audio->nextEvent = audio->nextCh2;
-					}
-				}
-
-				if (audio->ch2.control.stop) {
-					audio->ch2.control.endTime -= audio->eventDiff;
-					if (audio->ch2.control.endTime <= 0) {
-						audio->playingCh2 = 0;
-					}
-				}
-			}
-
-			if (audio->playingCh3) {
-				audio->nextCh3 -= audio->eventDiff;
-				if (audio->nextCh3 <= 0) {
-					audio->nextCh3 += _updateChannel3(&audio->ch3);
-					if (audio->nextCh3 < audio->nextEvent) {
-						audio->nextEvent = audio->nextCh3;
-					}
-				}
-
-				if (audio->ch3.control.stop) {
-					audio->ch3.control.endTime -= audio->eventDiff;
-					if (audio->ch3.control.endTime <= 0) {
-						audio->playingCh3 = 0;
-					}
-				}
-			}
-
-			if (audio->playingCh4 && !audio->ch4.envelope.dead) {
-				audio->nextCh4 -= audio->eventDiff;
-				if (audio->ch4.envelope.nextStep != INT_MAX) {
-					audio->ch4.envelope.nextStep -= audio->eventDiff;
-					if (audio->ch4.envelope.nextStep <= 0) {
-						int8_t sample = (audio->ch4.sample >> 31) * 0x8;
-						_updateEnvelope(&audio->ch4.envelope);
-						if (audio->ch4.envelope.nextStep < audio->nextEvent) {
-							audio->nextEvent = audio->ch4.envelope.nextStep;
-						}
-						audio->ch4.sample = sample * audio->ch4.envelope.currentVolume;
-					}
-				}
-
-				if (audio->nextCh4 <= 0) {
-					audio->nextCh4 += _updateChannel4(&audio->ch4);
-					if (audio->nextCh4 < audio->nextEvent) {
-						audio->nextEvent = audio->nextCh4;
-					}
-				}
-
-				if (audio->ch4.control.stop) {
-					audio->ch4.control.endTime -= audio->eventDiff;
-					if (audio->ch4.control.endTime <= 0) {
-						audio->playingCh4 = 0;
-					}
-				}
-			}
-		}
-
-		audio->nextSample -= audio->eventDiff;
+		_renderPSG(audio);
 		if (audio->nextSample <= 0) {
 			_sample(audio);
 			audio->nextSample += audio->sampleInterval;
 		}
-
-		if (audio->nextSample < audio->nextEvent) {
-			audio->nextEvent = audio->nextSample;
-		}
-		audio->eventDiff = 0;
+		audio->nextEvent = audio->nextSample;
 	}
 	return audio->nextEvent;
 }
@@ -274,6 +137,7 @@ void GBAAudioScheduleFifoDma(struct GBAAudio* audio, int number, struct GBADMA*
 }
 
 void GBAAudioWriteSOUND1CNT_LO(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch1.sweep.shift = GBAAudioRegisterSquareSweepGetShift(value);
 	audio->ch1.sweep.direction = GBAAudioRegisterSquareSweepGetDirection(value);
 	audio->ch1.sweep.time = GBAAudioRegisterSquareSweepGetTime(value);
@@ -285,12 +149,14 @@ void GBAAudioWriteSOUND1CNT_LO(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUND1CNT_HI(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	if (!_writeEnvelope(&audio->ch1.envelope, value)) {
 		audio->ch1.sample = 0;
 	}
 }
 
 void GBAAudioWriteSOUND1CNT_X(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch1.control.frequency = GBAAudioRegisterControlGetFrequency(value);
 	audio->ch1.control.stop = GBAAudioRegisterControlGetStop(value);
 	audio->ch1.control.endTime = (GBA_ARM7TDMI_FREQUENCY * (64 - audio->ch1.envelope.length)) >> 8;
@@ -319,12 +185,14 @@ void GBAAudioWriteSOUND1CNT_X(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUND2CNT_LO(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	if (!_writeEnvelope(&audio->ch2.envelope, value)) {
 		audio->ch2.sample = 0;
 	}
 }
 
 void GBAAudioWriteSOUND2CNT_HI(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch2.control.frequency = GBAAudioRegisterControlGetFrequency(value);
 	audio->ch2.control.stop = GBAAudioRegisterControlGetStop(value);
 	audio->ch2.control.endTime = (GBA_ARM7TDMI_FREQUENCY * (64 - audio->ch2.envelope.length)) >> 8;
@@ -341,6 +209,7 @@ void GBAAudioWriteSOUND2CNT_HI(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUND3CNT_LO(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch3.bank.size = GBAAudioRegisterBankGetSize(value);
 	audio->ch3.bank.bank = GBAAudioRegisterBankGetBank(value);
 	audio->ch3.bank.enable = GBAAudioRegisterBankGetEnable(value);
@@ -350,11 +219,13 @@ void GBAAudioWriteSOUND3CNT_LO(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUND3CNT_HI(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch3.wave.length = GBAAudioRegisterBankWaveGetLength(value);
 	audio->ch3.wave.volume = GBAAudioRegisterBankWaveGetVolume(value);
 }
 
 void GBAAudioWriteSOUND3CNT_X(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch3.control.rate = GBAAudioRegisterControlGetRate(value);
 	audio->ch3.control.stop = GBAAudioRegisterControlGetStop(value);
 	audio->ch3.control.endTime = (GBA_ARM7TDMI_FREQUENCY * (256 - audio->ch3.wave.length)) >> 8;
@@ -364,12 +235,14 @@ void GBAAudioWriteSOUND3CNT_X(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUND4CNT_LO(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	if (!_writeEnvelope(&audio->ch4.envelope, value)) {
 		audio->ch4.sample = 0;
 	}
 }
 
 void GBAAudioWriteSOUND4CNT_HI(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->ch4.control.ratio = GBAAudioRegisterCh4ControlGetRatio(value);
 	audio->ch4.control.frequency = GBAAudioRegisterCh4ControlGetFrequency(value);
 	audio->ch4.control.power = GBAAudioRegisterCh4ControlGetPower(value);
@@ -419,6 +292,7 @@ void GBAAudioWriteSOUNDCNT_HI(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUNDCNT_X(struct GBAAudio* audio, uint16_t value) {
+	_flushPSG(audio);
 	audio->enable = GBARegisterSOUNDCNT_XGetEnable(value);
 }
 
@@ -427,6 +301,7 @@ void GBAAudioWriteSOUNDBIAS(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteWaveRAM(struct GBAAudio* audio, int address, uint32_t value) {
+	_flushPSG(audio);
 	audio->ch3.wavedata[address | (!audio->ch3.bank.bank * 4)] = value;
 }
 
@@ -463,71 +338,48 @@ void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
 		return;
 	}
 	if (CircleBufferSize(&channel->fifo) <= 4 * sizeof(int32_t)) {
-		struct GBADMA* dma = &audio->p->memory.dma[channel->dmaSource];
-		dma->nextCount = 4;
-		dma->nextEvent = 0;
-		GBAMemoryUpdateDMAs(audio->p, -cycles);
+		CircleBufferRead8(&channel->fifo, &channel->sample);
+		// 先取样再补充，与DMA在本轮事件稍后才传输的顺序一致
+		if (!GBAMemoryFeedFIFO(audio->p, channel->dmaSource)) {
+			struct GBADMA* dma = &audio->p->memory.dma[channel->dmaSource];
+			dma->nextCount = 4;
+			dma->nextEvent = 0;
+			GBAMemoryUpdateDMAs(audio->p, -cycles);
+		}
+		return;
 	}
 	CircleBufferRead8(&channel->fifo, &channel->sample);
 }
 
 unsigned GBAAudioCopy(struct GBAAudio* audio, void* left, void* right, unsigned nSamples) {
 	GBASyncLockAudio(audio->p->sync);
-	unsigned read = 0;
-	if (left) {
-		unsigned readL = CircleBufferRead(&audio->left, left, nSamples * sizeof(int32_t)) >> 2;
-		if (readL < nSamples) {
-			memset((int32_t*) left + readL, 0, nSamples - readL);
+	unsigned read = AudioRingRead(&audio->buffer, left, right, nSamples);
+	if (read < nSamples) {
+		if (left) {
+			memset((int32_t*) left + read, 0, (nSamples - read) * sizeof(int32_t));
 		}
-		read = readL;
-	}
-	if (right) {
-		unsigned readR = CircleBufferRead(&audio->right, right, nSamples * sizeof(int32_t)) >> 2;
-		if (readR < nSamples) {
-			memset((int32_t*) right + readR, 0, nSamples - readR);
+		if (right) {
+			memset((int32_t*) right + read, 0, (nSamples - read) * sizeof(int32_t));
 		}
-		read = read >= readR ? read : readR;
 	}
 	GBASyncConsumeAudio(audio->p->sync);
 	return read;
 }
 
-unsigned GBAAudioResampleNN(struct GBAAudio* audio, float ratio, float* drift, struct GBAStereoSample* output, unsigned nSamples) {
-	int32_t left[GBA_AUDIO_SAMPLES];
-	int32_t right[GBA_AUDIO_SAMPLES];
-
-	// toRead is in GBA samples
-	// TODO: Do this with fixed-point math
-	unsigned toRead = ceilf(nSamples / ratio);
-	unsigned totalRead = 0;
-	while (nSamples) {
-		unsigned currentRead = GBA_AUDIO_SAMPLES;
-		if (currentRead > toRead) {
-			currentRead = toRead;
-		}
-		unsigned read = GBAAudioCopy(audio, left, right, currentRead);
-		toRead -= read;
-		unsigned i;
-		for (i = 0; i < read; ++i) {
-			*drift += ratio;
-			while (*drift >= 1.f) {
-				output->left = left[i];
-				output->right = right[i];
-				++output;
-				++totalRead;
-				--nSamples;
-				*drift -= 1.f;
-				if (!nSamples) {
-					return totalRead;
-				}
-			}
-		}
-		if (read < currentRead) {
-			memset(output, 0, nSamples * sizeof(struct GBAStereoSample));
-			break;
-		}
+// 交给stream后清空暂存的样本；stream为空时直接丢弃，之后连接的stream不会收到之前的样本
+void GBAAudioFlushStream(struct GBAAudio* audio, struct GBAAVStream* stream) {
+	if (stream && audio->streamSamples) {
+		GBAAVStreamPostAudio(stream, audio->streamBuffer, audio->streamSamples);
 	}
-	return totalRead;
+	audio->streamSamples = 0;
+}
+
+static unsigned _readResamplerInput(void* context, int32_t* left, int32_t* right, unsigned nSamples) {
+	return GBAAudioCopy(context, left, right, nSamples);
+}
+
+unsigned GBAAudioResample(struct GBAAudio* audio, struct GBAResampler* resampler, struct GBAStereoSample* output, unsigned nSamples) {
+	return GBAResamplerProcess(resampler, _readResamplerInput, audio, output, nSamples);
 }
 
 bool _writeEnvelope(struct GBAAudioEnvelope* envelope, uint16_t value) {
@@ -687,6 +539,165 @@ static int _applyBias(struct GBAAudio* audio, int sample) {
 	return (sample - GBARegisterSOUNDBIASGetBias(audio->soundbias)) << 6;
 }
 
+// 距下一次步进的周期数，INT_MAX表示不会步进
+static int32_t _earlier(int32_t step, int32_t next) {
+	return next < step ? next : step;
+}
+
+static void _renderChannel1(struct GBAAudio* audio, int32_t cycles) {
+	struct GBAAudioChannel1* ch = &audio->ch1;
+	while (audio->playingCh1 && !ch->envelope.dead) {
+		int32_t step = _earlier(audio->nextCh1, _earlier(ch->envelope.nextStep, ch->nextSweep));
+		if (ch->control.stop) {
+			step = _earlier(step, ch->control.endTime);
+		}
+		step = step < 0 ? 0 : _earlier(step, cycles);
+		cycles -= step;
+
+		audio->nextCh1 -= step;
+		if (ch->envelope.nextStep != INT_MAX) {
+			ch->envelope.nextStep -= step;
+			if (ch->envelope.nextStep <= 0) {
+				int8_t sample = ch->control.hi * 0x10 - 0x8;
+				_updateEnvelope(&ch->envelope);
+				ch->sample = sample * ch->envelope.currentVolume;
+			}
+		}
+		if (ch->nextSweep != INT_MAX) {
+			ch->nextSweep -= step;
+			if (ch->nextSweep <= 0) {
+				audio->playingCh1 = _updateSweep(ch);
+			}
+		}
+		if (audio->nextCh1 <= 0) {
+			audio->nextCh1 += _updateChannel1(ch);
+		}
+		if (ch->control.stop) {
+			ch->control.endTime -= step;
+			if (ch->control.endTime <= 0) {
+				audio->playingCh1 = 0;
+			}
+		}
+		if (cycles <= 0) {
+			break;
+		}
+	}
+}
+
+static void _renderChannel2(struct GBAAudio* audio, int32_t cycles) {
+	struct GBAAudioChannel2* ch = &audio->ch2;
+	while (audio->playingCh2 && !ch->envelope.dead) {
+		int32_t step = _earlier(audio->nextCh2, ch->envelope.nextStep);
+		if (ch->control.stop) {
+			step = _earlier(step, ch->control.endTime);
+		}
+		step = step < 0 ? 0 : _earlier(step, cycles);
+		cycles -= step;
+
+		audio->nextCh2 -= step;
+		if (ch->envelope.nextStep != INT_MAX) {
+			ch->envelope.nextStep -= step;
+			if (ch->envelope.nextStep <= 0) {
+				int8_t sample = ch->control.hi * 0x10 - 0x8;
+				_updateEnvelope(&ch->envelope);
+				ch->sample = sample * ch->envelope.currentVolume;
+			}
+		}
+		if (audio->nextCh2 <= 0) {
+			audio->nextCh2 += _updateChannel2(ch);
+		}
+		if (ch->control.stop) {
+			ch->control.endTime -= step;
+			if (ch->control.endTime <= 0) {
+				audio->playingCh2 = 0;
+			}
+		}
+		if (cycles <= 0) {
+			break;
+		}
+	}
+}
+
+static void _renderChannel3(struct GBAAudio* audio, int32_t cycles) {
+	struct GBAAudioChannel3* ch = &audio->ch3;
+	while (audio->playingCh3) {
+		int32_t step = audio->nextCh3;
+		if (ch->control.stop) {
+			step = _earlier(step, ch->control.endTime);
+		}
+		step = step < 0 ? 0 : _earlier(step, cycles);
+		cycles -= step;
+
+		audio->nextCh3 -= step;
+		if (audio->nextCh3 <= 0) {
+			audio->nextCh3 += _updateChannel3(ch);
+		}
+		if (ch->control.stop) {
+			ch->control.endTime -= step;
+			if (ch->control.endTime <= 0) {
+				audio->playingCh3 = 0;
+			}
+		}
+		if (cycles <= 0) {
+			break;
+		}
+	}
+}
+
+static void _renderChannel4(struct GBAAudio* audio, int32_t cycles) {
+	struct GBAAudioChannel4* ch = &audio->ch4;
+	while (audio->playingCh4 && !ch->envelope.dead) {
+		int32_t step = _earlier(audio->nextCh4, ch->envelope.nextStep);
+		if (ch->control.stop) {
+			step = _earlier(step, ch->control.endTime);
+		}
+		step = step < 0 ? 0 : _earlier(step, cycles);
+		cycles -= step;
+
+		audio->nextCh4 -= step;
+		if (ch->envelope.nextStep != INT_MAX) {
+			ch->envelope.nextStep -= step;
+			if (ch->envelope.nextStep <= 0) {
+				int8_t sample = (ch->sample >> 31) * 0x8;
+				_updateEnvelope(&ch->envelope);
+				ch->sample = sample * ch->envelope.currentVolume;
+			}
+		}
+		if (audio->nextCh4 <= 0) {
+			audio->nextCh4 += _updateChannel4(ch);
+		}
+		if (ch->control.stop) {
+			ch->control.endTime -= step;
+			if (ch->control.endTime <= 0) {
+				audio->playingCh4 = 0;
+			}
+		}
+		if (cycles <= 0) {
+			break;
+		}
+	}
+}
+
+// 把PSG推进eventDiff个周期，取样时刻也随之前移
+static void _renderPSG(struct GBAAudio* audio) {
+	int32_t cycles = audio->eventDiff;
+	audio->eventDiff = 0;
+	audio->nextSample -= cycles;
+	if (!audio->enable) {
+		return;
+	}
+	_renderChannel1(audio, cycles);
+	_renderChannel2(audio, cycles);
+	_renderChannel3(audio, cycles);
+	_renderChannel4(audio, cycles);
+}
+
+// 写入会改变PSG状态的寄存器前调用，写入从上一次事件循环的时刻开始生效
+static void _flushPSG(struct GBAAudio* audio) {
+	GBASyncEventSource(audio->p, GBA_EVENT_AUDIO);
+	_renderPSG(audio);
+}
+
 static void _sample(struct GBAAudio* audio) {
 	int32_t sampleLeft = 0;
 	int32_t sampleRight = 0;
@@ -746,15 +757,16 @@ static void _sample(struct GBAAudio* audio) {
 	sampleLeft = _applyBias(audio, sampleLeft);
 	sampleRight = _applyBias(audio, sampleRight);
 
-	GBASyncLockAudio(audio->p->sync);
-	CircleBufferWrite32(&audio->left, sampleLeft);
-	CircleBufferWrite32(&audio->right, sampleRight);
-	unsigned produced = CircleBufferSize(&audio->left);
-	struct GBAThread* thread = GBAThreadGetContext();
-	if (thread && thread->stream) {
-		thread->stream->postAudioFrame(thread->stream, sampleLeft, sampleRight);
+	AudioRingWrite(&audio->buffer, sampleLeft, sampleRight);
+	audio->streamBuffer[audio->streamSamples].left = sampleLeft;
+	audio->streamBuffer[audio->streamSamples].right = sampleRight;
+	if (++audio->streamSamples == GBA_AUDIO_STREAM_BLOCK) {
+		struct GBAThread* thread = GBAThreadGetContext();
+		GBAAudioFlushStream(audio, thread ? thread->stream : 0);
+	}
+	if (AudioRingSize(&audio->buffer) >= GBASyncAudioLimit(audio->p->sync, &audio->buffer)) {
+		GBASyncProduceAudio(audio->p->sync, &audio->buffer);
 	}
-	GBASyncProduceAudio(audio->p->sync, produced >= CircleBufferCapacity(&audio->left));
 }
 
 void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState* state) {
@@ -840,3 +852,25 @@ void GBAAudioDeserialize(struct GBAAudio* audio, const struct GBASerializedState
 float GBAAudioCalculateRatio(struct GBAAudio* audio, float desiredFPS, float desiredSampleRate) {
 	return desiredSampleRate * GBA_ARM7TDMI_FREQUENCY / (VIDEO_TOTAL_LENGTH * desiredFPS * audio->sampleRate);
 }
+
+/*
+动态速率控制，由消费者在每次读取前调用
+缓冲区比半满更满时稍微降低比例，多消耗输入；更空时稍微提高比例，让缓冲区回升
+调整幅度最多为GBA_AUDIO_RATE_CONTROL_DELTA，耳朵听不出音高变化，但足以抵消两边时钟的漂移
+填充程度偏离半满GBA_AUDIO_RATE_CONTROL_WINDOW个容量时达到最大幅度；窗口太宽时，生产者较慢的情况下
+缓冲区要降到一次回调的用量以下才能调整到位，每次回调都会欠载
+*/
+float GBAAudioControlRatio(struct GBAAudio* audio, float ratio) {
+	size_t capacity = AudioRingCapacity(&audio->buffer);
+	if (!capacity) {
+		return ratio;
+	}
+	float fill = AudioRingSize(&audio->buffer) / (float) capacity;
+	float error = (0.5f - fill) / GBA_AUDIO_RATE_CONTROL_WINDOW;
+	if (error > 1.f) {
+		error = 1.f;
+	} else if (error < -1.f) {
+		error = -1.f;
+	}
+	return ratio * (1.f + GBA_AUDIO_RATE_CONTROL_DELTA * error);
+}
@@ -9,12 +9,16 @@
 #include "util/common.h"
 #include "macros.h"
 
+#include "gba-resampler.h"
+#include "util/audio-ring.h"
 #include "util/circle-buffer.h"
 
 struct GBADMA;
 
 extern const unsigned GBA_AUDIO_SAMPLES;
 
+#define GBA_AUDIO_STREAM_BLOCK 1024
+
 DECL_BITFIELD(GBAAudioRegisterEnvelope, uint16_t);
 DECL_BITS(GBAAudioRegisterEnvelope, Length, 0, 6);
 DECL_BITS(GBAAudioRegisterEnvelope, Duty, 6, 2);
@@ -177,8 +181,9 @@ struct GBAAudio {
 	struct GBAAudioFIFO chA;
 	struct GBAAudioFIFO chB;
 
-	struct CircleBuffer left;
-	struct CircleBuffer right;
+	struct AudioRing buffer;		//输出的样本，模拟线程写入，音频回调读出
+	struct AudioFrame streamBuffer[GBA_AUDIO_STREAM_BLOCK];		//攒够一块或到帧末尾时才交给GBAAVStream
+	unsigned streamSamples;
 
 	uint8_t volumeRight;
 	uint8_t volumeLeft;
@@ -222,11 +227,6 @@ struct GBAAudio {
 	int32_t sampleInterval;
 };
 
-struct GBAStereoSample {
-	int16_t left;
-	int16_t right;
-};
-
 void GBAAudioInit(struct GBAAudio* audio, size_t samples);
 void GBAAudioReset(struct GBAAudio* audio);
 void GBAAudioDeinit(struct GBAAudio* audio);
@@ -256,12 +256,15 @@ void GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value);
 void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles);
 
 unsigned GBAAudioCopy(struct GBAAudio* audio, void* left, void* right, unsigned nSamples);
-unsigned GBAAudioResampleNN(struct GBAAudio*, float ratio, float* drift, struct GBAStereoSample* output, unsigned nSamples);
+struct GBAAVStream;
+void GBAAudioFlushStream(struct GBAAudio* audio, struct GBAAVStream* stream);
+unsigned GBAAudioResample(struct GBAAudio* audio, struct GBAResampler* resampler, struct GBAStereoSample* output, unsigned nSamples);
 
 struct GBASerializedState;
 void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState* state);
 void GBAAudioDeserialize(struct GBAAudio* audio, const struct GBASerializedState* state);
 
 float GBAAudioCalculateRatio(struct GBAAudio* audio, float desiredFPS, float desiredSampleRatio);
+float GBAAudioControlRatio(struct GBAAudio* audio, float ratio);
 
 #endif
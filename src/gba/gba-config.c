@@ -196,6 +196,22 @@ void GBAConfigMap(const struct GBAConfig* config, struct GBAOptions* opts) {
 	if (_lookupIntValue(config, "videoSync", &fakeBool)) {
 		opts->videoSync = fakeBool;
 	}
+	if (_lookupIntValue(config, "audioRateControl", &fakeBool)) {
+		opts->audioRateControl = fakeBool;
+	}
+	if (_lookupIntValue(config, "jit", &fakeBool)) {
+		opts->useJIT = fakeBool;
+	}
+	if (_lookupIntValue(config, "blockCache", &fakeBool)) {
+		opts->useBlockCache = fakeBool;
+	}
+	_lookupIntValue(config, "hugePages", &opts->hugePages);
+	if (_lookupIntValue(config, "prefaultMemory", &fakeBool)) {
+		opts->prefaultMemory = fakeBool;
+	}
+	if (_lookupIntValue(config, "lockMemory", &fakeBool)) {
+		opts->lockMemory = fakeBool;
+	}
 
 	_lookupIntValue(config, "fullscreen", &opts->fullscreen);
 	_lookupIntValue(config, "width", &opts->width);
@@ -212,6 +228,7 @@ void GBAConfigLoadDefaults(struct GBAConfig* config, const struct GBAOptions* op
 	ConfigurationSetUIntValue(&config->defaultsTable, 0, "audioBuffers", opts->audioBuffers);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "audioSync", opts->audioSync);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "videoSync", opts->videoSync);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "audioRateControl", opts->audioRateControl);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "fullscreen", opts->fullscreen);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "width", opts->width);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "height", opts->height);
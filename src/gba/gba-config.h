@@ -31,6 +31,14 @@ struct GBAOptions {
 
 	bool videoSync;
 	bool audioSync;
+	bool audioRateControl;		//按缓冲区填充程度微调重采样比例，audioSync时生产者在半满处等待
+
+	bool useJIT;
+	bool useBlockCache;
+
+	int hugePages;			//enum MemoryHugePages
+	bool prefaultMemory;
+	bool lockMemory;
 };
 
 void GBAConfigInit(struct GBAConfig*, const char* port);
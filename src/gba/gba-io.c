@@ -289,6 +289,7 @@ void GBAIOInit(struct GBA* gba) {
 }
 
 void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value) {
+	GBA_COUNT(gba, ioWrites[(address & (SIZE_IO - 1)) >> 1], 1);
 	if (address < REG_SOUND1CNT_LO && address != REG_DISPSTAT) {
 		value = gba->video.renderer->writeVideoRegister(gba->video.renderer, address, value);
 	} else {
@@ -343,10 +344,14 @@ void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value) {
 			GBAAudioWriteSOUNDCNT_LO(&gba->audio, value);
 			break;
 		case REG_SOUNDCNT_HI:
+			GBATimersCatchUp(gba);
 			GBAAudioWriteSOUNDCNT_HI(&gba->audio, value);
+			GBATimersSchedule(gba);
 			break;
 		case REG_SOUNDCNT_X:
+			GBATimersCatchUp(gba);
 			GBAAudioWriteSOUNDCNT_X(&gba->audio, value);
+			GBATimersSchedule(gba);
 			break;
 		case REG_SOUNDBIAS:
 			GBAAudioWriteSOUNDBIAS(&gba->audio, value);
@@ -487,6 +492,7 @@ void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value) {
 
 void GBAIOWrite8(struct GBA* gba, uint32_t address, uint8_t value) {
 	if (address == REG_HALTCNT) {
+		GBA_COUNT(gba, ioWrites[REG_HALTCNT >> 1], 1);
 		value &= 0x80;
 		if (!value) {
 			GBAHalt(gba);
@@ -543,14 +549,36 @@ void GBAIOWrite32(struct GBA* gba, uint32_t address, uint32_t value) {
 		GBAMemoryWriteDMADAD(gba, 3, value);
 		break;
 	default:
+		if (!(address & 3) && GBAIOIsVideoRegisterRange(address, 2)) {
+			uint16_t values[2] = { value, value >> 16 };
+			GBAIOWriteVideoRegisters(gba, address, values, 2);
+			return;
+		}
 		GBAIOWrite(gba, address, value & 0xFFFF);
 		GBAIOWrite(gba, address | 2, value >> 16);
 		return;
 	}
+	GBA_COUNT(gba, ioWrites[(address & (SIZE_IO - 1)) >> 1], 1);
 	gba->memory.io[address >> 1] = value;
 	gba->memory.io[(address >> 1) + 1] = value >> 16;
 }
 
+// 从address开始的count个寄存器都只交给渲染器处理（DISPSTAT之外、REG_SOUND1CNT_LO之前）时可以成批写入
+bool GBAIOIsVideoRegisterRange(uint32_t address, size_t count) {
+	uint32_t end = address + (count << 1);
+	return end <= REG_SOUND1CNT_LO && (address > REG_DISPSTAT || end <= REG_DISPSTAT);
+}
+
+// 与逐个调用GBAIOWrite的结果相同，调用者需先用GBAIOIsVideoRegisterRange检查
+void GBAIOWriteVideoRegisters(struct GBA* gba, uint32_t address, uint16_t* values, size_t count) {
+	gba->video.renderer->writeVideoRegisters(gba->video.renderer, address, values, count);
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		GBA_COUNT(gba, ioWrites[(address >> 1) + i], 1);
+		gba->memory.io[(address >> 1) + i] = values[i];
+	}
+}
+
 uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
 	switch (address) {
 	case REG_TM0CNT_LO:
@@ -157,6 +157,8 @@ void GBAIOInit(struct GBA* gba);
 void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value);
 void GBAIOWrite8(struct GBA* gba, uint32_t address, uint8_t value);
 void GBAIOWrite32(struct GBA* gba, uint32_t address, uint32_t value);
+bool GBAIOIsVideoRegisterRange(uint32_t address, size_t count);
+void GBAIOWriteVideoRegisters(struct GBA* gba, uint32_t address, uint16_t* values, size_t count);
 uint16_t GBAIORead(struct GBA* gba, uint32_t address);
 
 struct GBASerializedState;
@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "gba-memory.h"
 
+#include "decoder.h"
+#include "isa-inlines.h"
 #include "macros.h"
 
 #include "gba-gpio.h"
@@ -15,9 +17,41 @@
 
 static uint32_t _popcount32(unsigned bits);
 static uint32_t _deadbeef = 0xDEADBEEF;
+static const int8_t _noPrefetchCredit[GBA_PREFETCH_MAX_CYCLES + 1];
 
 static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t region);
+static void _setActiveWaitstates(struct GBA* gba);
 static void GBAMemoryServiceDMA(struct GBA* gba, int number, struct GBADMA* info);
+static int GBAMemoryBurstDMA(struct GBA* gba, int number, struct GBADMA* info, int32_t budget);
+static void _finishDMA(struct GBA* gba, int number, struct GBADMA* info);
+static void _invalidateCode(struct GBAMemory* memory);
+static void _detectIdleLoop(struct GBA* gba, uint32_t address);
+
+#define IDLE_LOOP_MAX_LENGTH 8		//空闲循环体最多包含的指令数
+#define IDLE_LOOP_MAX_SCAN 128		//检查空闲循环时最多检查的顺序指令数，超过时无法确定之后有没有回到入口的跳转
+
+// 占用cycles个周期的数据访问期间，预取缓冲读入的半字之后节省的取指周期
+static inline int _creditFor(const int8_t* credit, uint32_t address, int cycles) {
+	if (address >= BASE_CART0) {
+		return 0;
+	}
+	return credit[cycles < GBA_PREFETCH_MAX_CYCLES ? cycles : GBA_PREFETCH_MAX_CYCLES];
+}
+
+static inline int _prefetchCredit(const struct GBAMemory* memory, uint32_t address, int cycles) {
+	return _creditFor(memory->activePrefetchCredit, address, cycles);
+}
+
+#define INVALIDATE_WORKING_RAM ++memory->wramGenerations[(address & (SIZE_WORKING_RAM - 1)) >> ARM_BLOCK_CACHE_PAGE_BITS];
+#define INVALIDATE_WORKING_IRAM ++memory->iwramGenerations[(address & (SIZE_WORKING_IRAM - 1)) >> ARM_BLOCK_CACHE_PAGE_BITS];
+
+#define MARK_DIRTY(BITMAP, OFFSET) \
+	do { \
+		if (UNLIKELY(memory->dirtySubscribers)) { \
+			uint32_t page = (OFFSET) >> GBA_DIRTY_PAGE_BITS; \
+			memory->BITMAP[page >> 5] |= 1 << (page & 31); \
+		} \
+	} while (0)
 
 /*
 Shows the Bus-Width, supported read and write widths, 
@@ -86,23 +120,21 @@ void GBAMemoryInit(struct GBA* gba) {
 
 	int i;
 	for (i = 0; i < 16; ++i) {
-		gba->memory.waitstatesNonseq16[i] = GBA_BASE_WAITSTATES[i];
-		gba->memory.waitstatesSeq16[i] = GBA_BASE_WAITSTATES_SEQ[i];
-		gba->memory.waitstatesPrefetchNonseq16[i] = GBA_BASE_WAITSTATES[i];
-		gba->memory.waitstatesPrefetchSeq16[i] = GBA_BASE_WAITSTATES_SEQ[i];
-		gba->memory.waitstatesNonseq32[i] = GBA_BASE_WAITSTATES_32[i];
-		gba->memory.waitstatesSeq32[i] = GBA_BASE_WAITSTATES_SEQ_32[i];
-		gba->memory.waitstatesPrefetchNonseq32[i] = GBA_BASE_WAITSTATES_32[i];
-		gba->memory.waitstatesPrefetchSeq32[i] = GBA_BASE_WAITSTATES_SEQ_32[i];
-	}
-	for (; i < 256; ++i) {
-		gba->memory.waitstatesNonseq16[i] = 0;
-		gba->memory.waitstatesSeq16[i] = 0;
-		gba->memory.waitstatesNonseq32[i] = 0;
-		gba->memory.waitstatesSeq32[i] = 0;
+		gba->memory.waitstates[i][GBA_WAIT_NONSEQ16] = GBA_BASE_WAITSTATES[i];
+		gba->memory.waitstates[i][GBA_WAIT_SEQ16] = GBA_BASE_WAITSTATES_SEQ[i];
+		gba->memory.waitstates[i][GBA_WAIT_PREFETCH_NONSEQ16] = GBA_BASE_WAITSTATES[i];
+		gba->memory.waitstates[i][GBA_WAIT_PREFETCH_SEQ16] = GBA_BASE_WAITSTATES_SEQ[i];
+		gba->memory.waitstates[i][GBA_WAIT_NONSEQ32] = GBA_BASE_WAITSTATES_32[i];
+		gba->memory.waitstates[i][GBA_WAIT_SEQ32] = GBA_BASE_WAITSTATES_SEQ_32[i];
+		gba->memory.waitstates[i][GBA_WAIT_PREFETCH_NONSEQ32] = GBA_BASE_WAITSTATES_32[i];
+		gba->memory.waitstates[i][GBA_WAIT_PREFETCH_SEQ32] = GBA_BASE_WAITSTATES_SEQ_32[i];
 	}
+	memset(gba->memory.waitstates[16], 0, sizeof(gba->memory.waitstates[0]) * (256 - 16));
 
+	gba->memory.prefetch = false;
+	gba->memory.activePrefetchCredit = _noPrefetchCredit;
 	gba->memory.activeRegion = -1;
+	cpu->memory.fastCycleSet = 0;
 	cpu->memory.activeRegion = 0;
 	cpu->memory.activeMask = 0;
 	cpu->memory.setActiveRegion = GBASetActiveRegion;
@@ -112,28 +144,34 @@ void GBAMemoryInit(struct GBA* gba) {
 	cpu->memory.activeNonseqCycles16 = 0;
 	cpu->memory.activeUncachedCycles32 = 0;
 	cpu->memory.activeUncachedCycles16 = 0;
+	memset(cpu->memory.fastRegions, 0, sizeof(cpu->memory.fastRegions));
 	gba->memory.biosPrefetch = 0;
+
+	gba->memory.dirtySubscribers = 0;
+	GBAMemoryClearDirty(&gba->memory);
 }
 
 void GBAMemoryDeinit(struct GBA* gba) {
-	mappedMemoryFree(gba->memory.wram, SIZE_WORKING_RAM);
-	mappedMemoryFree(gba->memory.iwram, SIZE_WORKING_IRAM);
+	residentMemoryFree(gba->memory.wram, SIZE_WORKING_RAM);
+	residentMemoryFree(gba->memory.iwram, SIZE_WORKING_IRAM);
 	if (gba->memory.rom) {
-		mappedMemoryFree(gba->memory.rom, gba->memory.romSize);
+		residentMemoryFree(gba->memory.rom, gba->memory.romSize);
 	}
 	GBASavedataDeinit(&gba->memory.savedata);
 }
 
 void GBAMemoryReset(struct GBA* gba) {
 	if (gba->memory.wram) {
-		mappedMemoryFree(gba->memory.wram, SIZE_WORKING_RAM);
+		residentMemoryFree(gba->memory.wram, SIZE_WORKING_RAM);
 	}
-	gba->memory.wram = anonymousMemoryMap(SIZE_WORKING_RAM);
+	gba->memory.wram = residentMemoryMap(SIZE_WORKING_RAM);
 
 	if (gba->memory.iwram) {
-		mappedMemoryFree(gba->memory.iwram, SIZE_WORKING_IRAM);
+		residentMemoryFree(gba->memory.iwram, SIZE_WORKING_IRAM);
 	}
-	gba->memory.iwram = anonymousMemoryMap(SIZE_WORKING_IRAM);
+	gba->memory.iwram = residentMemoryMap(SIZE_WORKING_IRAM);
+	_invalidateCode(&gba->memory);
+	GBAMemoryMarkAllDirty(&gba->memory);
 
 	memset(gba->memory.io, 0, sizeof(gba->memory.io));
 	memset(gba->memory.dma, 0, sizeof(gba->memory.dma));
@@ -153,6 +191,216 @@ void GBAMemoryReset(struct GBA* gba) {
 	}
 }
 
+// 指令改写的寄存器，按位表示
+static uint32_t _writtenRegisters(const struct ARMInstructionInfo* info) {
+	uint32_t written = 0;
+	if ((info->operandFormat & (ARM_OPERAND_REGISTER_1 | ARM_OPERAND_AFFECTED_1)) == (ARM_OPERAND_REGISTER_1 | ARM_OPERAND_AFFECTED_1)) {
+		written |= 1 << info->op1.reg;
+	}
+	if ((info->operandFormat & (ARM_OPERAND_REGISTER_2 | ARM_OPERAND_AFFECTED_2)) == (ARM_OPERAND_REGISTER_2 | ARM_OPERAND_AFFECTED_2)) {
+		written |= 1 << info->op2.reg;
+	}
+	if (info->mnemonic == ARM_MN_LDM) {
+		written |= info->op1.immediate;
+	}
+	if ((info->mnemonic == ARM_MN_LDR || info->mnemonic == ARM_MN_LDM) && (info->memory.format & (ARM_MEMORY_WRITEBACK | ARM_MEMORY_POST_INCREMENT))) {
+		written |= 1 << info->memory.baseReg;
+	}
+	return written;
+}
+
+/*
+空闲循环只能轮询I/O、IWRAM或WRAM中的字，卡带区域（GPIO、EEPROM、Flash和SRAM）的读取可能有副作用或随时间变化，
+除了PC相对的文字池外都不允许
+地址必须能在入口处确定：基址和偏移寄存器在此之前没有被循环体改写，入口处的寄存器每一轮都相同
+计时器的计数随周期变化，也不能读取
+*/
+static bool _isIdleLoopLoad(struct ARMCore* cpu, const struct ARMInstructionInfo* info, uint32_t written) {
+	if (info->memory.baseReg == ARM_PC) {
+		return true;
+	}
+	if (written & (1 << info->memory.baseReg)) {
+		return false;
+	}
+	uint32_t address = cpu->gprs[info->memory.baseReg];
+	int32_t offset = 0;
+	if (info->memory.format & ARM_MEMORY_IMMEDIATE_OFFSET) {
+		offset = info->memory.offset.immediate;
+	} else if (info->memory.format & ARM_MEMORY_REGISTER_OFFSET) {
+		if ((info->memory.format & ARM_MEMORY_SHIFTED_OFFSET) || (written & (1 << info->memory.offset.reg))) {
+			return false;
+		}
+		offset = cpu->gprs[info->memory.offset.reg];
+	}
+	if (!(info->memory.format & ARM_MEMORY_POST_INCREMENT)) {
+		address += info->memory.format & ARM_MEMORY_OFFSET_SUBTRACT ? -offset : offset;
+	}
+	switch (address >> BASE_OFFSET) {
+	case REGION_WORKING_RAM:
+	case REGION_WORKING_IRAM:
+		return true;
+	case REGION_IO:
+		address &= OFFSET_MASK;
+		return address < REG_TM0CNT_LO || address > REG_TM3CNT_HI;
+	default:
+		return false;
+	}
+}
+
+/*
+空闲循环检测
+_detectIdleLoop只在同区域跳转到入口时计数：跳到别处的同区域跳转会改变候选地址，跨区域跳转会清除候选（进出BIOS的异常除外，异常返回到被打断的指令）
+所以两次计数之间执行的是从入口开始的一段顺序代码，最后由其中某条跳转回到入口
+从入口开始顺序检查，直到无条件的B离开这段代码；每条可能回到入口的跳转（B、BL到入口，或目标未知）之前的指令都必须符合要求：
+只能有读内存和运算指令，不能写内存、修改CPSR控制位或产生异常，条件成立时跳出循环的B指令除外
+SWI等异常返回后继续执行下一条，之后的指令视为不符合要求
+跳回入口的跳转必须在前IDLE_LOOP_MAX_LENGTH条指令中
+*/
+static bool _isIdleLoopBody(struct ARMCore* cpu, uint32_t address) {
+	int width = cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	uint32_t pc = address;
+	uint32_t written = 0;
+	uint32_t link = 0;
+	bool linkKnown = false;
+	bool loop = false;		//已找到回边
+	bool clean = true;		//从入口到当前指令都符合空闲循环的要求
+	int i;
+	for (i = 0; i < IDLE_LOOP_MAX_SCAN; ++i, pc += width) {
+		struct ARMInstructionInfo info;
+		if (cpu->executionMode == MODE_THUMB) {
+			uint16_t opcode;
+			LOAD_16(opcode, pc & cpu->memory.activeMask, cpu->memory.activeRegion);
+			ARMDecodeThumb(opcode, &info);
+		} else {
+			uint32_t opcode;
+			LOAD_32(opcode, pc & cpu->memory.activeMask, cpu->memory.activeRegion);
+			ARMDecodeARM(opcode, &info);
+		}
+		bool unconditional = info.condition == ARM_CONDITION_AL;
+		bool targetKnown = false;
+		uint32_t target = 0;
+		if (info.traps) {
+			// SWI等异常由BIOS处理后返回下一条，期间的代码没有检查
+			clean = false;
+			continue;
+		}
+		if (info.mnemonic == ARM_MN_BLH) {
+			// THUMB的BL由两条指令组成，前一条设置LR
+			link = pc + width * 2 + info.op1.immediate;
+			linkKnown = true;
+			written |= 1 << ARM_LR;
+			continue;
+		}
+		if (info.mnemonic == ARM_MN_B && info.branchType == ARM_BRANCH) {
+			target = pc + width * 2 + info.op1.immediate;
+			targetKnown = true;
+		} else if (info.mnemonic == ARM_MN_BL && info.branchType == ARM_BRANCH_LINKED) {
+			if (cpu->executionMode == MODE_THUMB) {
+				target = link + info.op1.immediate;
+				targetKnown = linkKnown;
+			} else {
+				target = pc + width * 2 + info.op1.immediate;
+				targetKnown = true;
+			}
+		}
+		linkKnown = false;
+		if (info.branchType != ARM_BRANCH_NONE) {
+			if (!targetKnown || target == address) {
+				// 可能回到入口：从入口到这里的指令都要符合要求，读取PC的指令本身也要检查
+				if (!clean || ((info.mnemonic == ARM_MN_LDR || info.mnemonic == ARM_MN_LDM) && !_isIdleLoopLoad(cpu, &info, written))) {
+					return false;
+				}
+			}
+			if (targetKnown && target == address) {
+				if (i >= IDLE_LOOP_MAX_LENGTH) {
+					return false;
+				}
+				loop = true;
+			}
+			if (unconditional) {
+				return loop;
+			}
+			// 条件不成立时继续执行下一条；成立时跳到别处，候选地址随之改变
+			continue;
+		}
+		switch (info.mnemonic) {
+		case ARM_MN_LDR:
+		case ARM_MN_LDM:
+			if (!_isIdleLoopLoad(cpu, &info, written)) {
+				clean = false;
+			}
+			break;
+		case ARM_MN_STR:
+		case ARM_MN_STM:
+		case ARM_MN_SWP:
+		case ARM_MN_MSR:
+			clean = false;
+			break;
+		default:
+			break;
+		}
+		written |= _writtenRegisters(&info);
+	}
+	return false;
+}
+
+/*
+每次在同一区域内跳转时调用
+连续两次跳到同一地址，且循环体符合_isIdleLoopBody的要求时，记录当时的寄存器
+之后再跳回该地址时寄存器完全相同，说明上一轮循环没有改变任何状态，只有事件（中断、DMA、视频等）才能让循环结束，
+于是像GBAHalt一样把cpu->cycles直接推进到cpu->nextEvent
+*/
+static void _detectIdleLoop(struct GBA* gba, uint32_t address) {
+	struct ARMCore* cpu = gba->cpu;
+	if (address != gba->idleLoopCandidate) {
+		gba->idleLoopCandidate = address;
+		gba->idleDetectionStep = 0;
+		return;
+	}
+	switch (gba->idleDetectionStep) {
+	case 0:
+		if (!_isIdleLoopBody(cpu, address)) {
+			gba->idleDetectionStep = -1;
+			return;
+		}
+		gba->idleDetectionStep = 1;
+		break;
+	case 1:
+		if (!memcmp(gba->idleRegisters, cpu->gprs, sizeof(gba->idleRegisters[0]) * ARM_PC) && gba->idleRegisters[ARM_PC] == cpu->cpsr.packed) {
+			if (cpu->cycles < cpu->nextEvent) {
+				cpu->cycles = cpu->nextEvent;
+			}
+			return;
+		}
+		break;
+	default:
+		return;
+	}
+	memcpy(gba->idleRegisters, cpu->gprs, sizeof(gba->idleRegisters[0]) * ARM_PC);
+	gba->idleRegisters[ARM_PC] = cpu->cpsr.packed;
+}
+
+// CPU核心取指时使用的等待周期，从当前区域的描述中取出
+static void _setActiveWaitstates(struct GBA* gba) {
+	struct ARMCore* cpu = gba->cpu;
+	const char* waitstates = gba->memory.waitstates[gba->memory.activeRegion];
+	cpu->memory.activeSeqCycles32 = waitstates[GBA_WAIT_PREFETCH_SEQ32];
+	cpu->memory.activeSeqCycles16 = waitstates[GBA_WAIT_PREFETCH_SEQ16];
+	cpu->memory.activeNonseqCycles32 = waitstates[GBA_WAIT_PREFETCH_NONSEQ32];
+	cpu->memory.activeNonseqCycles16 = waitstates[GBA_WAIT_PREFETCH_NONSEQ16];
+	cpu->memory.activeUncachedCycles32 = waitstates[GBA_WAIT_NONSEQ32];
+	cpu->memory.activeUncachedCycles16 = waitstates[GBA_WAIT_NONSEQ16];
+
+	// 数据访问的周期数随之改变；快速访存表已为每种预取状态算好周期数，只需切换所用的一组
+	struct GBAMemory* memory = &gba->memory;
+	int set = 0;
+	if (memory->prefetch && memory->activeRegion >= REGION_CART0 && memory->activeRegion <= REGION_CART2_EX) {
+		set = ((memory->activeRegion - REGION_CART0) >> 1) + 1;
+	}
+	memory->activePrefetchCredit = set ? memory->prefetchCredit[set - 1] : _noPrefetchCredit;
+	cpu->memory.fastCycleSet = set;
+}
+
 /* 
  *cpu->memory.setActiveRegion = GBASetActiveRegion
  *cpu->memory.setActiveRegion(cpu, cpu->gprs[ARM_PC])
@@ -161,14 +409,23 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 
-	if (address == gba->busyLoop && memory->activeRegion != REGION_BIOS) {
-		GBAHalt(gba);
+	int newRegion = address >> BASE_OFFSET;
+	if (memory->activeRegion != REGION_BIOS) {
+		if (address == gba->busyLoop) {
+			GBAHalt(gba);
+		} else if (newRegion == memory->activeRegion) {
+			_detectIdleLoop(gba, address);
+		}
 	}
 
-	int newRegion = address >> BASE_OFFSET;
 	if (newRegion == memory->activeRegion) {
 		return;
 	}
+	// 跨区域跳转之后的代码没有经过_isIdleLoopBody的检查，重新开始检测
+	// 进出BIOS的是异常和异常返回，回到的是被打断的指令，不影响检测
+	if (newRegion != REGION_BIOS && memory->activeRegion != REGION_BIOS) {
+		gba->idleLoopCandidate = -1;
+	}
 	if (memory->activeRegion == REGION_BIOS) {
 		memory->biosPrefetch = cpu->prefetch;
 	}
@@ -207,12 +464,7 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 	}
 
 	//设置时钟周期cycel
-	cpu->memory.activeSeqCycles32 = memory->waitstatesPrefetchSeq32[memory->activeRegion];
-	cpu->memory.activeSeqCycles16 = memory->waitstatesPrefetchSeq16[memory->activeRegion];
-	cpu->memory.activeNonseqCycles32 = memory->waitstatesPrefetchNonseq32[memory->activeRegion];
-	cpu->memory.activeNonseqCycles16 = memory->waitstatesPrefetchNonseq16[memory->activeRegion];
-	cpu->memory.activeUncachedCycles32 = memory->waitstatesNonseq32[memory->activeRegion];
-	cpu->memory.activeUncachedCycles16 = memory->waitstatesNonseq16[memory->activeRegion];
+	_setActiveWaitstates(gba);
 }
 
 #define LOAD_BAD \
@@ -240,7 +492,7 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 
 #define LOAD_WORKING_RAM \
 	LOAD_32(value, address & (SIZE_WORKING_RAM - 1), memory->wram); \
-	wait += waitstatesRegion[REGION_WORKING_RAM];
+	wait += memory->waitstates[REGION_WORKING_RAM][waitstatesType];
 
 #define LOAD_WORKING_IRAM LOAD_32(value, address & (SIZE_WORKING_IRAM - 1), memory->iwram);
 #define LOAD_IO value = GBAIORead(gba, (address & (SIZE_IO - 1)) & ~2) | (GBAIORead(gba, (address & (SIZE_IO - 1)) | 2) << 16);
@@ -260,7 +512,7 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 #define LOAD_OAM LOAD_32(value, address & (SIZE_OAM - 1), gba->video.oam.raw);
 
 #define LOAD_CART \
-	wait += waitstatesRegion[address >> BASE_OFFSET]; \
+	wait += memory->waitstates[address >> BASE_OFFSET][waitstatesType]; \
 	if ((address & (SIZE_CART0 - 1)) < memory->romSize) { \
 		LOAD_32(value, address & (SIZE_CART0 - 1), memory->rom); \
 	} else { \
@@ -270,7 +522,7 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 	}
 
 #define LOAD_SRAM \
-	wait = memory->waitstatesNonseq16[address >> BASE_OFFSET]; \
+	wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ16]; \
 	value = GBALoad8(cpu, address, 0); \
 	value |= value << 8; \
 	value |= value << 16;
@@ -280,7 +532,7 @@ int32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
 	int wait = 0;
-	char* waitstatesRegion = memory->waitstatesNonseq32;
+	int waitstatesType = GBA_WAIT_NONSEQ32;
 
 	switch (address >> BASE_OFFSET) {
 	case REGION_BIOS:
@@ -322,7 +574,8 @@ int32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += 2 + wait;
+		wait += 2;
+		*cycleCounter += wait - _prefetchCredit(memory, address, wait);
 	}
 	// Unaligned 32-bit loads are "rotated" so they make some semblance of sense
 	int rotate = (address & 3) << 3;
@@ -359,7 +612,7 @@ int16_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		break;
 	case REGION_WORKING_RAM:
 		LOAD_16(value, address & (SIZE_WORKING_RAM - 1), memory->wram);
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+		wait = memory->waitstates[REGION_WORKING_RAM][GBA_WAIT_NONSEQ16];
 		break;
 	case REGION_WORKING_IRAM:
 		LOAD_16(value, address & (SIZE_WORKING_IRAM - 1), memory->iwram);
@@ -385,7 +638,7 @@ int16_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	case REGION_CART1:
 	case REGION_CART1_EX:
 	case REGION_CART2:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ16];
 		if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
 			LOAD_16(value, address & (SIZE_CART0 - 1), memory->rom);
 		} else {
@@ -394,7 +647,7 @@ int16_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		}
 		break;
 	case REGION_CART2_EX:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ16];
 		if (memory->savedata.type == SAVEDATA_EEPROM) {
 			value = GBASavedataReadEEPROM(&memory->savedata);
 		} else if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
@@ -406,7 +659,7 @@ int16_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		break;
 	case REGION_CART_SRAM:
 	case REGION_CART_SRAM_MIRROR:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ16];
 		value = GBALoad8(cpu, address, 0);
 		value |= value << 8;
 		break;
@@ -421,7 +674,8 @@ int16_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += 2 + wait;
+		wait += 2;
+		*cycleCounter += wait - _prefetchCredit(memory, address, wait);
 	}
 	// Unaligned 16-bit loads are "unpredictable", but the GBA rotates them, so we have to, too.
 	int rotate = (address & 1) << 3;
@@ -458,7 +712,7 @@ int8_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		break;
 	case REGION_WORKING_RAM:
 		value = ((int8_t*) memory->wram)[address & (SIZE_WORKING_RAM - 1)];
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+		wait = memory->waitstates[REGION_WORKING_RAM][GBA_WAIT_NONSEQ16];
 		break;
 	case REGION_WORKING_IRAM:
 		value = ((int8_t*) memory->iwram)[address & (SIZE_WORKING_IRAM - 1)];
@@ -485,7 +739,7 @@ int8_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	case REGION_CART1_EX:
 	case REGION_CART2:
 	case REGION_CART2_EX:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ16];
 		if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
 			value = ((int8_t*) memory->rom)[address & (SIZE_CART0 - 1)];
 		} else {
@@ -495,7 +749,7 @@ int8_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		break;
 	case REGION_CART_SRAM:
 	case REGION_CART_SRAM_MIRROR:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ16];
 		if (memory->savedata.type == SAVEDATA_NONE) {
 			GBALog(gba, GBA_LOG_INFO, "Detected SRAM savegame");
 			GBASavedataInitSRAM(&memory->savedata);
@@ -520,23 +774,29 @@ int8_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += 2 + wait;
+		wait += 2;
+		*cycleCounter += wait - _prefetchCredit(memory, address, wait);
 	}
 	return value;
 }
 
 #define STORE_WORKING_RAM \
 	STORE_32(value, address & (SIZE_WORKING_RAM - 1), memory->wram); \
-	wait += waitstatesRegion[REGION_WORKING_RAM];
+	INVALIDATE_WORKING_RAM \
+	MARK_DIRTY(wramDirty, address & (SIZE_WORKING_RAM - 1)); \
+	wait += memory->waitstates[REGION_WORKING_RAM][waitstatesType];
 
 #define STORE_WORKING_IRAM \
-	STORE_32(value, address & (SIZE_WORKING_IRAM - 1), memory->iwram);
+	STORE_32(value, address & (SIZE_WORKING_IRAM - 1), memory->iwram); \
+	INVALIDATE_WORKING_IRAM \
+	MARK_DIRTY(iwramDirty, address & (SIZE_WORKING_IRAM - 1));
 
 #define STORE_IO \
 	GBAIOWrite32(gba, address & (SIZE_IO - 1), value);
 
 #define STORE_PALETTE_RAM \
 	STORE_32(value, address & (SIZE_PALETTE_RAM - 1), gba->video.palette); \
+	MARK_DIRTY(paletteDirty, address & (SIZE_PALETTE_RAM - 1)); \
 	gba->video.renderer->writePalette(gba->video.renderer, (address & (SIZE_PALETTE_RAM - 1)) + 2, value >> 16); \
 	++wait; \
 	gba->video.renderer->writePalette(gba->video.renderer, address & (SIZE_PALETTE_RAM - 1), value);
@@ -544,13 +804,16 @@ int8_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 #define STORE_VRAM \
 	if ((address & 0x0001FFFF) < SIZE_VRAM) { \
 		STORE_32(value, address & 0x0001FFFF, gba->video.renderer->vram); \
+		MARK_DIRTY(vramDirty, address & 0x0001FFFF); \
 	} else { \
 		STORE_32(value, address & 0x00017FFF, gba->video.renderer->vram); \
+		MARK_DIRTY(vramDirty, address & 0x00017FFF); \
 	} \
 	++wait;
 
 #define STORE_OAM \
 	STORE_32(value, address & (SIZE_OAM - 1), gba->video.oam.raw); \
+	MARK_DIRTY(oamDirty, address & (SIZE_OAM - 1)); \
 	gba->video.renderer->writeOAM(gba->video.renderer, (address & (SIZE_OAM - 4)) >> 1); \
 	gba->video.renderer->writeOAM(gba->video.renderer, ((address & (SIZE_OAM - 4)) >> 1) + 1);
 
@@ -567,7 +830,7 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
-	char* waitstatesRegion = memory->waitstatesNonseq32;
+	int waitstatesType = GBA_WAIT_NONSEQ32;
 
 	switch (address >> BASE_OFFSET) {
 	case REGION_WORKING_RAM:
@@ -606,7 +869,8 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += 1 + wait;
+		wait += 1;
+		*cycleCounter += wait - _prefetchCredit(memory, address, wait);
 	}
 }
 
@@ -618,27 +882,35 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 	switch (address >> BASE_OFFSET) {
 	case REGION_WORKING_RAM:
 		STORE_16(value, address & (SIZE_WORKING_RAM - 1), memory->wram);
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+		INVALIDATE_WORKING_RAM
+		MARK_DIRTY(wramDirty, address & (SIZE_WORKING_RAM - 1));
+		wait = memory->waitstates[REGION_WORKING_RAM][GBA_WAIT_NONSEQ16];
 		break;
 	case REGION_WORKING_IRAM:
 		STORE_16(value, address & (SIZE_WORKING_IRAM - 1), memory->iwram);
+		INVALIDATE_WORKING_IRAM
+		MARK_DIRTY(iwramDirty, address & (SIZE_WORKING_IRAM - 1));
 		break;
 	case REGION_IO:
 		GBAIOWrite(gba, address & (SIZE_IO - 1), value);
 		break;
 	case REGION_PALETTE_RAM:
 		STORE_16(value, address & (SIZE_PALETTE_RAM - 1), gba->video.palette);
+		MARK_DIRTY(paletteDirty, address & (SIZE_PALETTE_RAM - 1));
 		gba->video.renderer->writePalette(gba->video.renderer, address & (SIZE_PALETTE_RAM - 1), value);
 		break;
 	case REGION_VRAM:
 		if ((address & 0x0001FFFF) < SIZE_VRAM) {
 			STORE_16(value, address & 0x0001FFFF, gba->video.renderer->vram);
+			MARK_DIRTY(vramDirty, address & 0x0001FFFF);
 		} else {
 			STORE_16(value, address & 0x00017FFF, gba->video.renderer->vram);
+			MARK_DIRTY(vramDirty, address & 0x00017FFF);
 		}
 		break;
 	case REGION_OAM:
 		STORE_16(value, address & (SIZE_OAM - 1), gba->video.oam.raw);
+		MARK_DIRTY(oamDirty, address & (SIZE_OAM - 1));
 		gba->video.renderer->writeOAM(gba->video.renderer, (address & (SIZE_OAM - 1)) >> 1);
 		break;
 	case REGION_CART0:
@@ -666,7 +938,8 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += 1 + wait;
+		wait += 1;
+		*cycleCounter += wait - _prefetchCredit(memory, address, wait);
 	}
 }
 
@@ -678,10 +951,14 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 	switch (address >> BASE_OFFSET) {
 	case REGION_WORKING_RAM:
 		((int8_t*) memory->wram)[address & (SIZE_WORKING_RAM - 1)] = value;
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+		INVALIDATE_WORKING_RAM
+		MARK_DIRTY(wramDirty, address & (SIZE_WORKING_RAM - 1));
+		wait = memory->waitstates[REGION_WORKING_RAM][GBA_WAIT_NONSEQ16];
 		break;
 	case REGION_WORKING_IRAM:
 		((int8_t*) memory->iwram)[address & (SIZE_WORKING_IRAM - 1)] = value;
+		INVALIDATE_WORKING_IRAM
+		MARK_DIRTY(iwramDirty, address & (SIZE_WORKING_IRAM - 1));
 		break;
 	case REGION_IO:
 		GBAIOWrite8(gba, address & (SIZE_IO - 1), value);
@@ -697,6 +974,7 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		}
 		((int8_t*) gba->video.renderer->vram)[address & 0x1FFFE] = value;
 		((int8_t*) gba->video.renderer->vram)[(address & 0x1FFFE) | 1] = value;
+		MARK_DIRTY(vramDirty, address & 0x1FFFE);
 		break;
 	case REGION_OAM:
 		GBALog(gba, GBA_LOG_GAME_ERROR, "Cannot Store8 to OAM: 0x%08X", address);
@@ -722,7 +1000,7 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		} else {
 			GBALog(gba, GBA_LOG_GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 		}
-		wait = memory->waitstatesNonseq16[REGION_CART_SRAM];
+		wait = memory->waitstates[REGION_CART_SRAM][GBA_WAIT_NONSEQ16];
 		break;
 	default:
 		GBALog(gba, GBA_LOG_GAME_ERROR, "Bad memory Store8: 0x%08X", address);
@@ -730,36 +1008,54 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += 1 + wait;
+		wait += 1;
+		*cycleCounter += wait - _prefetchCredit(memory, address, wait);
 	}
 }
 
+/*
+LDM/STM的快速路径：传输的所有字都落在fastRegions中同一个可直接访问的区域内时，返回第一个字的宿主地址
+调用者一次性拷贝所有寄存器，等待周期按 非序列 + 序列 * (count - 1) + count 计算，与逐字访问的结果相同
+*/
+static uint8_t* _multipleFastPath(struct GBA* gba, uint32_t address, int count, uint8_t flag) {
+	uint32_t region = address >> BASE_OFFSET;
+	if (!count || region >= ARM_FAST_REGION_COUNT || (address + ((count - 1) << 2)) >> BASE_OFFSET != region) {
+		return 0;
+	}
+	const struct ARMFastRegion* fastRegion = &gba->cpu->memory.fastRegions[region];
+	uint32_t offset = address & fastRegion->mask;
+	if (!(fastRegion->flags & flag) || offset + (count << 2) > fastRegion->size) {
+		return 0;
+	}
+	return &fastRegion->base[offset];
+}
+
 #define LDM_LOOP(LDM) \
 	for (i = 0; i < 16; i += 4) { \
 		if (UNLIKELY(mask & (1 << i))) { \
 			LDM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			cpu->gprs[i] = value; \
 			++wait; \
 			address += 4; \
 		} \
 		if (UNLIKELY(mask & (2 << i))) { \
 			LDM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			cpu->gprs[i + 1] = value; \
 			++wait; \
 			address += 4; \
 		} \
 		if (UNLIKELY(mask & (4 << i))) { \
 			LDM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			cpu->gprs[i + 2] = value; \
 			++wait; \
 			address += 4; \
 		} \
 		if (UNLIKELY(mask & (8 << i))) { \
 			LDM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			cpu->gprs[i + 3] = value; \
 			++wait; \
 			address += 4; \
@@ -771,7 +1067,7 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value;
 	int wait = 0;
-	char* waitstatesRegion = memory->waitstatesNonseq32;
+	int waitstatesType = GBA_WAIT_NONSEQ32;
 
 	int i;
 	int offset = 4;
@@ -789,47 +1085,61 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 	uint32_t addressMisalign = address & 0x3;
 	address &= 0xFFFFFFFC;
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_BIOS:
-		LDM_LOOP(LOAD_BIOS);
-		break;
-	case REGION_WORKING_RAM:
-		LDM_LOOP(LOAD_WORKING_RAM);
-		break;
-	case REGION_WORKING_IRAM:
-		LDM_LOOP(LOAD_WORKING_IRAM);
-		break;
-	case REGION_IO:
-		LDM_LOOP(LOAD_IO);
-		break;
-	case REGION_PALETTE_RAM:
-		LDM_LOOP(LOAD_PALETTE_RAM);
-		break;
-	case REGION_VRAM:
-		LDM_LOOP(LOAD_VRAM);
-		break;
-	case REGION_OAM:
-		LDM_LOOP(LOAD_OAM);
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		LDM_LOOP(LOAD_CART);
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		LDM_LOOP(LOAD_SRAM);
-		break;
-	default:
-		LDM_LOOP(LOAD_BAD);
-		break;
+	int count = popcount ? popcount : _popcount32(mask);
+	ARM_COUNT_ACCESSES(cpu, address, count);
+	uint8_t* block = _multipleFastPath(gba, address, count, ARM_FAST_LOAD);
+	if (block) {
+		for (i = 0; i < 16; ++i) {
+			if (mask & (1 << i)) {
+				LOAD_32(cpu->gprs[i], 0, block);
+				block += 4;
+			}
+		}
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ32] + memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_SEQ32] * (count - 1) + count;
+		address += count << 2;
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_BIOS:
+			LDM_LOOP(LOAD_BIOS);
+			break;
+		case REGION_WORKING_RAM:
+			LDM_LOOP(LOAD_WORKING_RAM);
+			break;
+		case REGION_WORKING_IRAM:
+			LDM_LOOP(LOAD_WORKING_IRAM);
+			break;
+		case REGION_IO:
+			LDM_LOOP(LOAD_IO);
+			break;
+		case REGION_PALETTE_RAM:
+			LDM_LOOP(LOAD_PALETTE_RAM);
+			break;
+		case REGION_VRAM:
+			LDM_LOOP(LOAD_VRAM);
+			break;
+		case REGION_OAM:
+			LDM_LOOP(LOAD_OAM);
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			LDM_LOOP(LOAD_CART);
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			LDM_LOOP(LOAD_SRAM);
+			break;
+		default:
+			LDM_LOOP(LOAD_BAD);
+			break;
+		}
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += wait;
+		*cycleCounter += wait - _prefetchCredit(memory, address - 4, wait);
 	}
 
 	if (direction & LSM_B) {
@@ -848,28 +1158,28 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 		if (UNLIKELY(mask & (1 << i))) { \
 			value = cpu->gprs[i]; \
 			STM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			++wait; \
 			address += 4; \
 		} \
 		if (UNLIKELY(mask & (2 << i))) { \
 			value = cpu->gprs[i + 1]; \
 			STM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			++wait; \
 			address += 4; \
 		} \
 		if (UNLIKELY(mask & (4 << i))) { \
 			value = cpu->gprs[i + 2]; \
 			STM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			++wait; \
 			address += 4; \
 		} \
 		if (UNLIKELY(mask & (8 << i))) { \
 			value = cpu->gprs[i + 3]; \
 			STM; \
-			waitstatesRegion = memory->waitstatesSeq32; \
+			waitstatesType = GBA_WAIT_SEQ32; \
 			++wait; \
 			address += 4; \
 		} \
@@ -880,7 +1190,7 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value;
 	int wait = 0;
-	char* waitstatesRegion = memory->waitstatesNonseq32;
+	int waitstatesType = GBA_WAIT_NONSEQ32;
 
 	int i;
 	int offset = 4;
@@ -898,44 +1208,64 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 	uint32_t addressMisalign = address & 0x3;
 	address &= 0xFFFFFFFC;
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_WORKING_RAM:
-		STM_LOOP(STORE_WORKING_RAM);
-		break;
-	case REGION_WORKING_IRAM:
-		STM_LOOP(STORE_WORKING_IRAM);
-		break;
-	case REGION_IO:
-		STM_LOOP(STORE_IO);
-		break;
-	case REGION_PALETTE_RAM:
-		STM_LOOP(STORE_PALETTE_RAM);
-		break;
-	case REGION_VRAM:
-		STM_LOOP(STORE_VRAM);
-		break;
-	case REGION_OAM:
-		STM_LOOP(STORE_OAM);
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		STM_LOOP(STORE_CART);
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		STM_LOOP(STORE_SRAM);
-		break;
-	default:
-		STM_LOOP(STORE_BAD);
-		break;
+	int count = popcount ? popcount : _popcount32(mask);
+	ARM_COUNT_ACCESSES(cpu, address, count);
+	uint8_t* block = _multipleFastPath(gba, address, count, ARM_FAST_STORE);
+	if (block) {
+		const struct ARMFastRegion* region = &cpu->memory.fastRegions[address >> BASE_OFFSET];
+		uint32_t regionOffset = address & region->mask;
+		for (i = 0; i < 16; ++i) {
+			if (mask & (1 << i)) {
+				STORE_32(cpu->gprs[i], 0, block);
+				if (region->generations) {
+					++region->generations[regionOffset >> ARM_BLOCK_CACHE_PAGE_BITS];
+				}
+				block += 4;
+				regionOffset += 4;
+			}
+		}
+		wait = memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_NONSEQ32] + memory->waitstates[address >> BASE_OFFSET][GBA_WAIT_SEQ32] * (count - 1) + count;
+		address += count << 2;
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_WORKING_RAM:
+			STM_LOOP(STORE_WORKING_RAM);
+			break;
+		case REGION_WORKING_IRAM:
+			STM_LOOP(STORE_WORKING_IRAM);
+			break;
+		case REGION_IO:
+			STM_LOOP(STORE_IO);
+			break;
+		case REGION_PALETTE_RAM:
+			STM_LOOP(STORE_PALETTE_RAM);
+			break;
+		case REGION_VRAM:
+			STM_LOOP(STORE_VRAM);
+			break;
+		case REGION_OAM:
+			STM_LOOP(STORE_OAM);
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			STM_LOOP(STORE_CART);
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			STM_LOOP(STORE_SRAM);
+			break;
+		default:
+			STM_LOOP(STORE_BAD);
+			break;
+		}
 	}
 
 	if (cycleCounter) {
-		*cycleCounter += wait;
+		*cycleCounter += wait - _prefetchCredit(memory, address - 4, wait);
 	}
 
 	if (direction & LSM_B) {
@@ -949,9 +1279,42 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 	return address | addressMisalign;
 }
 
+// 每读入一个半字需要1+seq16个周期，之后从缓冲取指节省seq16个周期
+static void _setPrefetchCredit(int8_t* credit, int seq16) {
+	int cycles;
+	for (cycles = 0; cycles <= GBA_PREFETCH_MAX_CYCLES; ++cycles) {
+		int halfwords = cycles / (1 + seq16);
+		if (halfwords > GBA_PREFETCH_HALFWORDS) {
+			halfwords = GBA_PREFETCH_HALFWORDS;
+		}
+		credit[cycles] = halfwords * seq16;
+	}
+}
+
+// 卡带的两个镜像区域（如0x08和0x09）等待周期相同
+static void _setCartWaitstates(struct GBAMemory* memory, int region, char nonseq16, char seq16, bool prefetch) {
+	char* waitstates = memory->waitstates[region];
+	waitstates[GBA_WAIT_NONSEQ16] = nonseq16;
+	waitstates[GBA_WAIT_SEQ16] = seq16;
+	waitstates[GBA_WAIT_NONSEQ32] = seq16 + 1 + seq16;
+	waitstates[GBA_WAIT_SEQ32] = 2 * seq16 + 1;
+	_setPrefetchCredit(memory->prefetchCredit[(region - REGION_CART0) >> 1], seq16);
+	if (prefetch) {
+		waitstates[GBA_WAIT_PREFETCH_NONSEQ16] = waitstates[GBA_WAIT_SEQ16];
+		waitstates[GBA_WAIT_PREFETCH_SEQ16] = waitstates[GBA_WAIT_SEQ16];
+		waitstates[GBA_WAIT_PREFETCH_NONSEQ32] = waitstates[GBA_WAIT_SEQ32];
+		waitstates[GBA_WAIT_PREFETCH_SEQ32] = waitstates[GBA_WAIT_SEQ32];
+	} else {
+		waitstates[GBA_WAIT_PREFETCH_NONSEQ16] = waitstates[GBA_WAIT_NONSEQ16];
+		waitstates[GBA_WAIT_PREFETCH_SEQ16] = waitstates[GBA_WAIT_SEQ16];
+		waitstates[GBA_WAIT_PREFETCH_NONSEQ32] = waitstates[GBA_WAIT_NONSEQ32];
+		waitstates[GBA_WAIT_PREFETCH_SEQ32] = waitstates[GBA_WAIT_SEQ32];
+	}
+	memcpy(memory->waitstates[region + 1], waitstates, GBA_WAIT_MAX);
+}
+
 void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters) {
 	struct GBAMemory* memory = &gba->memory;
-	struct ARMCore* cpu = gba->cpu;
 	int sram = parameters & 0x0003;
 	int ws0 = (parameters & 0x000C) >> 2;
 	int ws0seq = (parameters & 0x0010) >> 4;
@@ -959,71 +1322,130 @@ void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters) {
 	int ws1seq = (parameters & 0x0080) >> 7;
 	int ws2 = (parameters & 0x0300) >> 8;
 	int ws2seq = (parameters & 0x0400) >> 10;
-	int prefetch = parameters & 0x4000;
-
-	memory->waitstatesNonseq16[REGION_CART_SRAM] = memory->waitstatesNonseq16[REGION_CART_SRAM_MIRROR] =  GBA_ROM_WAITSTATES[sram];
-	memory->waitstatesSeq16[REGION_CART_SRAM] = memory->waitstatesSeq16[REGION_CART_SRAM_MIRROR] = GBA_ROM_WAITSTATES[sram];
-	memory->waitstatesNonseq32[REGION_CART_SRAM] = memory->waitstatesNonseq32[REGION_CART_SRAM_MIRROR] = 2 * GBA_ROM_WAITSTATES[sram] + 1;
-	memory->waitstatesSeq32[REGION_CART_SRAM] = memory->waitstatesSeq32[REGION_CART_SRAM_MIRROR] = 2 * GBA_ROM_WAITSTATES[sram] + 1;
-
-	memory->waitstatesNonseq16[REGION_CART0] = memory->waitstatesNonseq16[REGION_CART0_EX] = GBA_ROM_WAITSTATES[ws0];
-	memory->waitstatesNonseq16[REGION_CART1] = memory->waitstatesNonseq16[REGION_CART1_EX] = GBA_ROM_WAITSTATES[ws1];
-	memory->waitstatesNonseq16[REGION_CART2] = memory->waitstatesNonseq16[REGION_CART2_EX] = GBA_ROM_WAITSTATES[ws2];
-
-	memory->waitstatesSeq16[REGION_CART0] = memory->waitstatesSeq16[REGION_CART0_EX] = GBA_ROM_WAITSTATES_SEQ[ws0seq];
-	memory->waitstatesSeq16[REGION_CART1] = memory->waitstatesSeq16[REGION_CART1_EX] = GBA_ROM_WAITSTATES_SEQ[ws1seq + 2];
-	memory->waitstatesSeq16[REGION_CART2] = memory->waitstatesSeq16[REGION_CART2_EX] = GBA_ROM_WAITSTATES_SEQ[ws2seq + 4];
-
-	memory->waitstatesNonseq32[REGION_CART0] = memory->waitstatesNonseq32[REGION_CART0_EX] = memory->waitstatesSeq16[REGION_CART0] + 1 + memory->waitstatesSeq16[REGION_CART0];
-	memory->waitstatesNonseq32[REGION_CART1] = memory->waitstatesNonseq32[REGION_CART1_EX] = memory->waitstatesSeq16[REGION_CART1] + 1 + memory->waitstatesSeq16[REGION_CART1];
-	memory->waitstatesNonseq32[REGION_CART2] = memory->waitstatesNonseq32[REGION_CART2_EX] = memory->waitstatesSeq16[REGION_CART2] + 1 + memory->waitstatesSeq16[REGION_CART2];
-
-	memory->waitstatesSeq32[REGION_CART0] = memory->waitstatesSeq32[REGION_CART0_EX] = 2 * memory->waitstatesSeq16[REGION_CART0] + 1;
-	memory->waitstatesSeq32[REGION_CART1] = memory->waitstatesSeq32[REGION_CART1_EX] = 2 * memory->waitstatesSeq16[REGION_CART1] + 1;
-	memory->waitstatesSeq32[REGION_CART2] = memory->waitstatesSeq32[REGION_CART2_EX] = 2 * memory->waitstatesSeq16[REGION_CART2] + 1;
+	bool prefetch = parameters & 0x4000;
+	memory->prefetch = prefetch;
+
+	int region;
+	for (region = REGION_CART_SRAM; region <= REGION_CART_SRAM_MIRROR; ++region) {
+		memory->waitstates[region][GBA_WAIT_NONSEQ16] = GBA_ROM_WAITSTATES[sram];
+		memory->waitstates[region][GBA_WAIT_SEQ16] = GBA_ROM_WAITSTATES[sram];
+		memory->waitstates[region][GBA_WAIT_NONSEQ32] = 2 * GBA_ROM_WAITSTATES[sram] + 1;
+		memory->waitstates[region][GBA_WAIT_SEQ32] = 2 * GBA_ROM_WAITSTATES[sram] + 1;
+	}
 
-	if (!prefetch) {
-		memory->waitstatesPrefetchSeq16[REGION_CART0] = memory->waitstatesPrefetchSeq16[REGION_CART0_EX] = memory->waitstatesSeq16[REGION_CART0];
-		memory->waitstatesPrefetchSeq16[REGION_CART1] = memory->waitstatesPrefetchSeq16[REGION_CART1_EX] = memory->waitstatesSeq16[REGION_CART1];
-		memory->waitstatesPrefetchSeq16[REGION_CART2] = memory->waitstatesPrefetchSeq16[REGION_CART2_EX] = memory->waitstatesSeq16[REGION_CART2];
+	_setCartWaitstates(memory, REGION_CART0, GBA_ROM_WAITSTATES[ws0], GBA_ROM_WAITSTATES_SEQ[ws0seq], prefetch);
+	_setCartWaitstates(memory, REGION_CART1, GBA_ROM_WAITSTATES[ws1], GBA_ROM_WAITSTATES_SEQ[ws1seq + 2], prefetch);
+	_setCartWaitstates(memory, REGION_CART2, GBA_ROM_WAITSTATES[ws2], GBA_ROM_WAITSTATES_SEQ[ws2seq + 4], prefetch);
 
-		memory->waitstatesPrefetchSeq32[REGION_CART0] = memory->waitstatesPrefetchSeq32[REGION_CART0_EX] = memory->waitstatesSeq32[REGION_CART0];
-		memory->waitstatesPrefetchSeq32[REGION_CART1] = memory->waitstatesPrefetchSeq32[REGION_CART1_EX] = memory->waitstatesSeq32[REGION_CART1];
-		memory->waitstatesPrefetchSeq32[REGION_CART2] = memory->waitstatesPrefetchSeq32[REGION_CART2_EX] = memory->waitstatesSeq32[REGION_CART2];
+	_setActiveWaitstates(gba);
+	GBAMemoryUpdateFastRegions(gba);
+}
 
-		memory->waitstatesPrefetchNonseq16[REGION_CART0] = memory->waitstatesPrefetchNonseq16[REGION_CART0_EX] = memory->waitstatesNonseq16[REGION_CART0];
-		memory->waitstatesPrefetchNonseq16[REGION_CART1] = memory->waitstatesPrefetchNonseq16[REGION_CART1_EX] = memory->waitstatesNonseq16[REGION_CART1];
-		memory->waitstatesPrefetchNonseq16[REGION_CART2] = memory->waitstatesPrefetchNonseq16[REGION_CART2_EX] = memory->waitstatesNonseq16[REGION_CART2];
+static void _setFastRegion(struct GBA* gba, int region, void* base, uint32_t mask, uint32_t size, uint32_t* generations, uint8_t flags) {
+	struct ARMFastRegion* fastRegion = &gba->cpu->memory.fastRegions[region];
+	if (!base) {
+		return;
+	}
+	fastRegion->base = base;
+	fastRegion->mask = mask;
+	fastRegion->size = size;
+	fastRegion->generations = generations;
+	fastRegion->flags = flags;
+	// 与GBALoad*和GBAStore*相同：读取2+等待周期，写入1+等待周期，再扣除预取缓冲节省的周期
+	// 第0组对应没有预取，第1到3组对应从CART0到CART2取指时的预取，见_setActiveWaitstates
+	const struct GBAMemory* memory = &gba->memory;
+	uint32_t address = region << BASE_OFFSET;
+	int wait32 = memory->waitstates[region][GBA_WAIT_NONSEQ32];
+	int wait16 = memory->waitstates[region][GBA_WAIT_NONSEQ16];
+	int set;
+	for (set = 0; set < ARM_FAST_CYCLE_SETS; ++set) {
+		const int8_t* credit = set ? memory->prefetchCredit[set - 1] : _noPrefetchCredit;
+		int8_t* cycles = fastRegion->cycles[set];
+		cycles[ARM_FAST_LOAD32_CYCLES] = 2 + wait32 - _creditFor(credit, address, 2 + wait32);
+		cycles[ARM_FAST_LOAD16_CYCLES] = 2 + wait16 - _creditFor(credit, address, 2 + wait16);
+		cycles[ARM_FAST_STORE32_CYCLES] = 1 + wait32 - _creditFor(credit, address, 1 + wait32);
+		cycles[ARM_FAST_STORE16_CYCLES] = 1 + wait16 - _creditFor(credit, address, 1 + wait16);
+	}
+}
 
-		memory->waitstatesPrefetchNonseq32[REGION_CART0] = memory->waitstatesPrefetchNonseq32[REGION_CART0_EX] = memory->waitstatesNonseq32[REGION_CART0];
-		memory->waitstatesPrefetchNonseq32[REGION_CART1] = memory->waitstatesPrefetchNonseq32[REGION_CART1_EX] = memory->waitstatesNonseq32[REGION_CART1];
-		memory->waitstatesPrefetchNonseq32[REGION_CART2] = memory->waitstatesPrefetchNonseq32[REGION_CART2_EX] = memory->waitstatesNonseq32[REGION_CART2];
-	} else {
-		memory->waitstatesPrefetchSeq16[REGION_CART0] = memory->waitstatesPrefetchSeq16[REGION_CART0_EX] = 0;
-		memory->waitstatesPrefetchSeq16[REGION_CART1] = memory->waitstatesPrefetchSeq16[REGION_CART1_EX] = 0;
-		memory->waitstatesPrefetchSeq16[REGION_CART2] = memory->waitstatesPrefetchSeq16[REGION_CART2_EX] = 0;
+/*
+重建cpu->memory.fastRegions，内存重新分配、载入ROM或WAITCNT改变后调用
+BIOS（有读保护）、I/O、OAM、SRAM和EEPROM所在的CART2_EX不放入表中
+调色板的写入要通知渲染器，VRAM的字节写入有特殊规则，这两种情况仍走慢速路径
+记录写入的页时，WRAM、IWRAM和VRAM的写入也走慢速路径
+连接调试器时表保持为空，所有访问都经过cpu->memory中的函数，观察点的shim才能看到
+*/
+void GBAMemoryUpdateFastRegions(struct GBA* gba) {
+	struct GBAMemory* memory = &gba->memory;
+	memset(gba->cpu->memory.fastRegions, 0, sizeof(gba->cpu->memory.fastRegions));
+	if (gba->debugger) {
+		return;
+	}
 
-		memory->waitstatesPrefetchSeq32[REGION_CART0] = memory->waitstatesPrefetchSeq32[REGION_CART0_EX] = 0;
-		memory->waitstatesPrefetchSeq32[REGION_CART1] = memory->waitstatesPrefetchSeq32[REGION_CART1_EX] = 0;
-		memory->waitstatesPrefetchSeq32[REGION_CART2] = memory->waitstatesPrefetchSeq32[REGION_CART2_EX] = 0;
+	uint8_t store = memory->dirtySubscribers ? 0 : ARM_FAST_STORE;
+	uint8_t store8 = memory->dirtySubscribers ? 0 : ARM_FAST_STORE8;
+	_setFastRegion(gba, REGION_WORKING_RAM, memory->wram, SIZE_WORKING_RAM - 1, SIZE_WORKING_RAM, memory->wramGenerations, ARM_FAST_LOAD | store | store8);
+	_setFastRegion(gba, REGION_WORKING_IRAM, memory->iwram, SIZE_WORKING_IRAM - 1, SIZE_WORKING_IRAM, memory->iwramGenerations, ARM_FAST_LOAD | store | store8);
+	_setFastRegion(gba, REGION_PALETTE_RAM, gba->video.palette, SIZE_PALETTE_RAM - 1, SIZE_PALETTE_RAM, 0, ARM_FAST_LOAD);
+	_setFastRegion(gba, REGION_VRAM, gba->video.renderer->vram, 0x0001FFFF, SIZE_VRAM, 0, ARM_FAST_LOAD | store);
+	int i;
+	for (i = REGION_CART0; i <= REGION_CART2; ++i) {
+		_setFastRegion(gba, i, memory->rom, SIZE_CART0 - 1, memory->romSize, 0, ARM_FAST_LOAD);
+	}
+}
 
-		memory->waitstatesPrefetchNonseq16[REGION_CART0] = memory->waitstatesPrefetchNonseq16[REGION_CART0_EX] = 0;
-		memory->waitstatesPrefetchNonseq16[REGION_CART1] = memory->waitstatesPrefetchNonseq16[REGION_CART1_EX] = 0;
-		memory->waitstatesPrefetchNonseq16[REGION_CART2] = memory->waitstatesPrefetchNonseq16[REGION_CART2_EX] = 0;
+// 订阅者负责在读取位图后调用GBAMemoryClearDirty；第一个订阅者没有之前的状态可比较，所有页都视为已写入
+void GBAMemorySubscribeDirty(struct GBA* gba) {
+	if (!gba->memory.dirtySubscribers++) {
+		GBAMemoryMarkAllDirty(&gba->memory);
+		GBAMemoryUpdateFastRegions(gba);
+	}
+}
 
-		memory->waitstatesPrefetchNonseq32[REGION_CART0] = memory->waitstatesPrefetchNonseq32[REGION_CART0_EX] = 0;
-		memory->waitstatesPrefetchNonseq32[REGION_CART1] = memory->waitstatesPrefetchNonseq32[REGION_CART1_EX] = 0;
-		memory->waitstatesPrefetchNonseq32[REGION_CART2] = memory->waitstatesPrefetchNonseq32[REGION_CART2_EX] = 0;
+void GBAMemoryUnsubscribeDirty(struct GBA* gba) {
+	if (gba->memory.dirtySubscribers && !--gba->memory.dirtySubscribers) {
+		GBAMemoryUpdateFastRegions(gba);
 	}
+}
 
-	cpu->memory.activeSeqCycles32 = memory->waitstatesPrefetchSeq32[memory->activeRegion];
-	cpu->memory.activeSeqCycles16 = memory->waitstatesPrefetchSeq16[memory->activeRegion];
+const uint32_t* GBAMemoryGetDirtyBitmap(const struct GBAMemory* memory, enum GBAMemoryRegion region, size_t* pages) {
+	switch (region) {
+	case REGION_WORKING_RAM:
+		*pages = SIZE_WORKING_RAM >> GBA_DIRTY_PAGE_BITS;
+		return memory->wramDirty;
+	case REGION_WORKING_IRAM:
+		*pages = SIZE_WORKING_IRAM >> GBA_DIRTY_PAGE_BITS;
+		return memory->iwramDirty;
+	case REGION_PALETTE_RAM:
+		*pages = SIZE_PALETTE_RAM >> GBA_DIRTY_PAGE_BITS;
+		return memory->paletteDirty;
+	case REGION_VRAM:
+		*pages = SIZE_VRAM >> GBA_DIRTY_PAGE_BITS;
+		return memory->vramDirty;
+	case REGION_OAM:
+		*pages = SIZE_OAM >> GBA_DIRTY_PAGE_BITS;
+		return memory->oamDirty;
+	default:
+		*pages = 0;
+		return 0;
+	}
+}
 
-	cpu->memory.activeNonseqCycles32 = memory->waitstatesPrefetchNonseq32[memory->activeRegion];
-	cpu->memory.activeNonseqCycles16 = memory->waitstatesPrefetchNonseq16[memory->activeRegion];
+void GBAMemoryClearDirty(struct GBAMemory* memory) {
+	memset(memory->wramDirty, 0, sizeof(memory->wramDirty));
+	memset(memory->iwramDirty, 0, sizeof(memory->iwramDirty));
+	memset(memory->paletteDirty, 0, sizeof(memory->paletteDirty));
+	memset(memory->vramDirty, 0, sizeof(memory->vramDirty));
+	memset(memory->oamDirty, 0, sizeof(memory->oamDirty));
+}
 
-	cpu->memory.activeUncachedCycles32 = memory->waitstatesNonseq32[memory->activeRegion];
-	cpu->memory.activeUncachedCycles16 = memory->waitstatesNonseq16[memory->activeRegion];
+//整块改写内存（重置、读档）后调用
+void GBAMemoryMarkAllDirty(struct GBAMemory* memory) {
+	memset(memory->wramDirty, 0xFF, sizeof(memory->wramDirty));
+	memset(memory->iwramDirty, 0xFF, sizeof(memory->iwramDirty));
+	memset(memory->paletteDirty, 0xFF, sizeof(memory->paletteDirty));
+	memset(memory->vramDirty, 0xFF, sizeof(memory->vramDirty));
+	memset(memory->oamDirty, 0xFF, sizeof(memory->oamDirty));
 }
 
 void GBAMemoryWriteDMASAD(struct GBA* gba, int dma, uint32_t address) {
@@ -1119,7 +1541,7 @@ void GBAMemoryRunVblankDMAs(struct GBA* gba, int32_t cycles) {
 	GBAMemoryUpdateDMAs(gba, 0);
 }
 
-int32_t GBAMemoryRunDMAs(struct GBA* gba, int32_t cycles) {
+int32_t GBAMemoryRunDMAs(struct GBA* gba, int32_t cycles, int32_t budget) {
 	struct GBAMemory* memory = &gba->memory;
 	if (memory->nextDMA == INT_MAX) {
 		return INT_MAX;
@@ -1128,7 +1550,10 @@ int32_t GBAMemoryRunDMAs(struct GBA* gba, int32_t cycles) {
 	memory->eventDiff += cycles;
 	if (memory->nextDMA <= 0) {
 		struct GBADMA* dma = &memory->dma[memory->activeDMA];
-		GBAMemoryServiceDMA(gba, memory->activeDMA, dma);
+		GBA_COUNT(gba, events[GBA_COUNTER_DMA], 1);
+		if (!GBAMemoryBurstDMA(gba, memory->activeDMA, dma, budget)) {
+			GBAMemoryServiceDMA(gba, memory->activeDMA, dma);
+		}
 		GBAMemoryUpdateDMAs(gba, memory->eventDiff);
 		memory->eventDiff = 0;
 	}
@@ -1138,7 +1563,8 @@ int32_t GBAMemoryRunDMAs(struct GBA* gba, int32_t cycles) {
 void GBAMemoryUpdateDMAs(struct GBA* gba, int32_t cycles) {
 	int i;
 	struct GBAMemory* memory = &gba->memory;
-	struct ARMCore* cpu = gba->cpu;
+	// nextDMA和eventDiff要先算上DMA事件源累计的周期
+	GBASyncEventSource(gba, GBA_EVENT_DMA);
 	memory->activeDMA = -1;
 	memory->nextDMA = INT_MAX;
 	for (i = 3; i >= 0; --i) {
@@ -1151,9 +1577,7 @@ void GBAMemoryUpdateDMAs(struct GBA* gba, int32_t cycles) {
 			}
 		}
 	}
-	if (memory->nextDMA < cpu->nextEvent) {
-		cpu->nextEvent = memory->nextDMA;
-	}
+	GBAScheduleEventSource(gba, GBA_EVENT_DMA, memory->nextDMA);
 }
 
 void GBAMemoryServiceDMA(struct GBA* gba, int number, struct GBADMA* info) {
@@ -1173,17 +1597,17 @@ void GBAMemoryServiceDMA(struct GBA* gba, int number, struct GBADMA* info) {
 		// TODO: support 4 cycles for ROM access
 		cycles += 2;
 		if (width == 4) {
-			cycles += memory->waitstatesNonseq32[sourceRegion] + memory->waitstatesNonseq32[destRegion];
+			cycles += memory->waitstates[sourceRegion][GBA_WAIT_NONSEQ32] + memory->waitstates[destRegion][GBA_WAIT_NONSEQ32];
 			source &= 0xFFFFFFFC;
 			dest &= 0xFFFFFFFC;
 		} else {
-			cycles += memory->waitstatesNonseq16[sourceRegion] + memory->waitstatesNonseq16[destRegion];
+			cycles += memory->waitstates[sourceRegion][GBA_WAIT_NONSEQ16] + memory->waitstates[destRegion][GBA_WAIT_NONSEQ16];
 		}
 	} else {
 		if (width == 4) {
-			cycles += memory->waitstatesSeq32[sourceRegion] + memory->waitstatesSeq32[destRegion];
+			cycles += memory->waitstates[sourceRegion][GBA_WAIT_SEQ32] + memory->waitstates[destRegion][GBA_WAIT_SEQ32];
 		} else {
-			cycles += memory->waitstatesSeq16[sourceRegion] + memory->waitstatesSeq16[destRegion];
+			cycles += memory->waitstates[sourceRegion][GBA_WAIT_SEQ16] + memory->waitstates[destRegion][GBA_WAIT_SEQ16];
 		}
 	}
 
@@ -1224,23 +1648,215 @@ void GBAMemoryServiceDMA(struct GBA* gba, int number, struct GBADMA* info) {
 		}
 	}
 
+	ARM_COUNT_ACCESS(cpu, info->nextSource);
+	ARM_COUNT_ACCESS(cpu, info->nextDest);
+	GBA_COUNT(gba, dmaUnits[number], 1);
+
 	if (!wordsRemaining) {
-		if (!GBADMARegisterIsRepeat(info->reg) || GBADMARegisterGetTiming(info->reg) == DMA_TIMING_NOW) {
-			info->reg = GBADMARegisterClearEnable(info->reg);
-			info->nextEvent = INT_MAX;
+		_finishDMA(gba, number, info);
+	} else {
+		info->nextDest = dest;
+		info->nextCount = wordsRemaining;
+	}
+	info->nextSource = source;
+
+	if (info->nextEvent != INT_MAX) {
+		info->nextEvent += cycles;
+	}
+	cpu->cycles += cycles;
+}
 
-			// Clear the enable bit in memory
-			memory->io[(REG_DMA0CNT_HI + number * (REG_DMA1CNT_HI - REG_DMA0CNT_HI)) >> 1] &= 0x7FE0;
+static void _finishDMA(struct GBA* gba, int number, struct GBADMA* info) {
+	struct GBAMemory* memory = &gba->memory;
+	if (!GBADMARegisterIsRepeat(info->reg) || GBADMARegisterGetTiming(info->reg) == DMA_TIMING_NOW) {
+		info->reg = GBADMARegisterClearEnable(info->reg);
+		info->nextEvent = INT_MAX;
+
+		// Clear the enable bit in memory
+		memory->io[(REG_DMA0CNT_HI + number * (REG_DMA1CNT_HI - REG_DMA0CNT_HI)) >> 1] &= 0x7FE0;
+	} else {
+		info->nextCount = info->count;
+		if (GBADMARegisterGetDestControl(info->reg) == DMA_INCREMENT_RELOAD) {
+			info->nextDest = info->dest;
+		}
+		GBAMemoryScheduleDMA(gba, number, info);
+	}
+	if (GBADMARegisterIsDoIRQ(info->reg)) {
+		GBARaiseIRQ(gba, IRQ_DMA0 + number);
+	}
+}
+
+/*
+Direct Sound的FIFO补充：计时器取样时FIFO不足16字节，直接从DMA源地址读4个字写入FIFO，不经过DMA事件
+周期数和完成后的处理（重复、中断）与GBAMemoryServiceDMA逐个单元传输相同
+DMA未按FIFO方式启用、宽度不是32位、目的不是FIFO或有更高优先级的DMA在等待时返回false，由调用者走一般的DMA调度
+*/
+bool GBAMemoryFeedFIFO(struct GBA* gba, int number) {
+	struct GBAMemory* memory = &gba->memory;
+	struct ARMCore* cpu = gba->cpu;
+	struct GBADMA* info = &memory->dma[number];
+	if (!GBADMARegisterIsEnable(info->reg) || GBADMARegisterGetTiming(info->reg) != DMA_TIMING_CUSTOM || !GBADMARegisterGetWidth(info->reg) || info->nextEvent != INT_MAX) {
+		return false;
+	}
+	uint32_t address = info->nextDest & 0x00FFFFFF;
+	if (info->nextDest >> BASE_OFFSET != REGION_IO || (address != REG_FIFO_A_LO && address != REG_FIFO_B_LO)) {
+		return false;
+	}
+	int i;
+	for (i = 0; i < number; ++i) {
+		if (GBADMARegisterIsEnable(memory->dma[i].reg) && memory->dma[i].nextEvent != INT_MAX) {
+			return false;
+		}
+	}
+
+	int sourceOffset = DMA_OFFSET[GBADMARegisterGetSrcControl(info->reg)] * 4;
+	uint32_t source = info->nextSource;
+	int32_t cycles = 0;
+	int32_t word = 0;
+	for (i = 0; i < 4; ++i) {
+		uint32_t sourceRegion = source >> BASE_OFFSET;
+		if (source == info->source) {
+			cycles += 2 + memory->waitstates[sourceRegion][GBA_WAIT_NONSEQ32] + memory->waitstates[REGION_IO][GBA_WAIT_NONSEQ32];
+			source &= 0xFFFFFFFC;
+		} else {
+			cycles += memory->waitstates[sourceRegion][GBA_WAIT_SEQ32] + memory->waitstates[REGION_IO][GBA_WAIT_SEQ32];
+		}
+		word = cpu->memory.load32(cpu, source, 0);
+		GBAAudioWriteFIFO(&gba->audio, address, word);
+		source += sourceOffset;
+	}
+	memory->io[address >> 1] = word;
+	memory->io[(address >> 1) + 1] = word >> 16;
+	gba->bus = word;
+	ARM_COUNT_ACCESSES(cpu, info->nextSource, 4);
+	ARM_COUNT_ACCESSES(cpu, info->nextDest, 4);
+	GBA_COUNT(gba, dmaUnits[number], 4);
+
+	info->nextSource = source;
+	_finishDMA(gba, number, info);
+	cpu->cycles += cycles;
+	return true;
+}
+
+static bool _isBurstSource(uint32_t region) {
+	switch (region) {
+	case REGION_WORKING_RAM:
+	case REGION_WORKING_IRAM:
+	case REGION_PALETTE_RAM:
+	case REGION_VRAM:
+	case REGION_OAM:
+	case REGION_CART0:
+	case REGION_CART0_EX:
+	case REGION_CART1:
+	case REGION_CART1_EX:
+	case REGION_CART2:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool _isBurstDest(uint32_t region) {
+	switch (region) {
+	case REGION_WORKING_RAM:
+	case REGION_WORKING_IRAM:
+	case REGION_PALETTE_RAM:
+	case REGION_VRAM:
+	case REGION_OAM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+突发传输：立即、HBlank和VBlank DMA在源和目的都是普通内存时，连续传输多个单元，不再每个单元都回到GBAProcessEvents
+budget是其他子系统下一个事件的剩余周期数，累计周期数达到budget时停下，让该事件在与逐个单元传输时相同的位置处理，
+因此结果与逐个单元传输完全一致。周期数按单元累加，规则与GBAMemoryServiceDMA相同
+遇到I/O、EEPROM、SRAM等地址时停下，剩余单元交给GBAMemoryServiceDMA；返回传输的单元数
+写入视频寄存器（如HBlank DMA每行改写滚动、仿射参数）时不停下，地址连续的寄存器攒在一起交给GBAIOWriteVideoRegisters
+*/
+static int GBAMemoryBurstDMA(struct GBA* gba, int number, struct GBADMA* info, int32_t budget) {
+	struct GBAMemory* memory = &gba->memory;
+	struct ARMCore* cpu = gba->cpu;
+	// 调试器的观察点只能看到经过cpu->memory的访问，此时逐个单元传输
+	if (GBADMARegisterGetTiming(info->reg) == DMA_TIMING_CUSTOM || gba->debugger) {
+		return 0;
+	}
+	uint32_t width = GBADMARegisterGetWidth(info->reg) ? 4 : 2;
+	int sourceOffset = DMA_OFFSET[GBADMARegisterGetSrcControl(info->reg)] * width;
+	int destOffset = DMA_OFFSET[GBADMARegisterGetDestControl(info->reg)] * width;
+	int32_t wordsRemaining = info->nextCount;
+	uint32_t source = info->nextSource;
+	uint32_t dest = info->nextDest;
+	int32_t cycles = 0;
+	int32_t word = 0;
+	int units = 0;
+	int ignored = 0;
+	// 视频寄存器一共REG_SOUND1CNT_LO >> 1个，地址连续的一段不会超过这个数
+	uint16_t videoValues[REG_SOUND1CNT_LO >> 1];
+	uint32_t videoAddress = 0;
+	size_t videoCount = 0;
+
+	while (wordsRemaining && (!units || cycles < budget)) {
+		uint32_t sourceRegion = source >> BASE_OFFSET;
+		uint32_t destRegion = dest >> BASE_OFFSET;
+		uint32_t unitDest = width == 4 && source == info->source ? dest & 0xFFFFFFFC : dest;
+		uint32_t videoOffset = unitDest & (SIZE_IO - 1);
+		bool toVideo = destRegion == REGION_IO && !(unitDest & (width - 1)) && GBAIOIsVideoRegisterRange(videoOffset, width >> 1);
+		if (!_isBurstSource(sourceRegion) || (!_isBurstDest(destRegion) && !toVideo)) {
+			break;
+		}
+		if (videoCount && (!toVideo || videoOffset != videoAddress + (videoCount << 1))) {
+			GBAIOWriteVideoRegisters(gba, videoAddress, videoValues, videoCount);
+			videoCount = 0;
+		}
+		if (width == 4) {
+			if (source == info->source) {
+				cycles += 2 + memory->waitstates[sourceRegion][GBA_WAIT_NONSEQ32] + memory->waitstates[destRegion][GBA_WAIT_NONSEQ32];
+				source &= 0xFFFFFFFC;
+				dest &= 0xFFFFFFFC;
+			} else {
+				cycles += memory->waitstates[sourceRegion][GBA_WAIT_SEQ32] + memory->waitstates[destRegion][GBA_WAIT_SEQ32];
+			}
+			word = _ARMLoad32(cpu, source, &ignored);
 		} else {
-			info->nextCount = info->count;
-			if (GBADMARegisterGetDestControl(info->reg) == DMA_INCREMENT_RELOAD) {
-				info->nextDest = info->dest;
+			if (source == info->source) {
+				cycles += 2 + memory->waitstates[sourceRegion][GBA_WAIT_NONSEQ16] + memory->waitstates[destRegion][GBA_WAIT_NONSEQ16];
+			} else {
+				cycles += memory->waitstates[sourceRegion][GBA_WAIT_SEQ16] + memory->waitstates[destRegion][GBA_WAIT_SEQ16];
 			}
-			GBAMemoryScheduleDMA(gba, number, info);
+			word = _ARMLoad16(cpu, source, &ignored);
 		}
-		if (GBADMARegisterIsDoIRQ(info->reg)) {
-			GBARaiseIRQ(gba, IRQ_DMA0 + number);
+		if (toVideo) {
+			ARM_COUNT_ACCESS(cpu, dest);
+			if (!videoCount) {
+				videoAddress = videoOffset;
+			}
+			videoValues[videoCount++] = word;
+			if (width == 4) {
+				videoValues[videoCount++] = word >> 16;
+			}
+		} else if (width == 4) {
+			_ARMStore32(cpu, dest, word, &ignored);
+		} else {
+			_ARMStore16(cpu, dest, word, &ignored);
 		}
+		source += sourceOffset;
+		dest += destOffset;
+		--wordsRemaining;
+		++units;
+	}
+	if (videoCount) {
+		GBAIOWriteVideoRegisters(gba, videoAddress, videoValues, videoCount);
+	}
+	if (!units) {
+		return 0;
+	}
+
+	gba->bus = width == 4 ? (uint32_t) word : (word | (word << 16));
+	if (!wordsRemaining) {
+		_finishDMA(gba, number, info);
 	} else {
 		info->nextDest = dest;
 		info->nextCount = wordsRemaining;
@@ -1251,6 +1867,8 @@ void GBAMemoryServiceDMA(struct GBA* gba, int number, struct GBADMA* info) {
 		info->nextEvent += cycles;
 	}
 	cpu->cycles += cycles;
+	GBA_COUNT(gba, dmaUnits[number], units);
+	return units;
 }
 
 void GBAMemorySerialize(struct GBAMemory* memory, struct GBASerializedState* state) {
@@ -1261,6 +1879,19 @@ void GBAMemorySerialize(struct GBAMemory* memory, struct GBASerializedState* sta
 void GBAMemoryDeserialize(struct GBAMemory* memory, struct GBASerializedState* state) {
 	memcpy(memory->wram, state->wram, SIZE_WORKING_RAM);
 	memcpy(memory->iwram, state->iwram, SIZE_WORKING_IRAM);
+	_invalidateCode(memory);
+	GBAMemoryMarkAllDirty(memory);
+}
+
+//整块改写内存后让所有预解码的块失效
+static void _invalidateCode(struct GBAMemory* memory) {
+	size_t i;
+	for (i = 0; i < sizeof(memory->wramGenerations) / sizeof(*memory->wramGenerations); ++i) {
+		++memory->wramGenerations[i];
+	}
+	for (i = 0; i < sizeof(memory->iwramGenerations) / sizeof(*memory->iwramGenerations); ++i) {
+		++memory->iwramGenerations[i];
+	}
 }
 
 uint32_t _popcount32(unsigned bits) {
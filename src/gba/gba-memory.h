@@ -9,6 +9,7 @@
 #include "util/common.h"
 
 #include "arm.h"
+#include "block-cache.h"
 #include "macros.h"
 
 #include "gba-gpio.h"
@@ -46,6 +47,9 @@ Unused Memory Area
   10000000-FFFFFFFF   Not used (upper 4bits of address bus unused)
 */
 
+#define GBA_DIRTY_PAGE_BITS 8
+#define GBA_DIRTY_WORDS(SIZE) ((((SIZE) >> GBA_DIRTY_PAGE_BITS) + 31) >> 5)
+
 enum GBAMemoryRegion {
 	REGION_BIOS = 0x0,
 	REGION_WORKING_RAM = 0x2,
@@ -142,6 +146,34 @@ struct GBADMA {
 	int32_t nextEvent;
 };
 
+/*
+每个区域的等待周期描述，一次下标访问即可取得某种访问的等待周期
+GBA_WAIT_PREFETCH_*是取指的等待周期。WAITCNT打开预取缓冲时，连续取指仍受卡带速度限制，与顺序数据访问相同；
+数据访问之后的取指由缓冲接着顺序读取，非顺序取指也按顺序周期计算。跳转会清空缓冲，使用GBA_WAIT_NONSEQ*
+关闭预取时取指与数据访问相同。其余区域没有预取缓冲，取指与数据访问相同
+*/
+enum GBAWaitstateType {
+	GBA_WAIT_SEQ32 = 0,
+	GBA_WAIT_SEQ16,
+	GBA_WAIT_NONSEQ32,
+	GBA_WAIT_NONSEQ16,
+	GBA_WAIT_PREFETCH_SEQ32,
+	GBA_WAIT_PREFETCH_SEQ16,
+	GBA_WAIT_PREFETCH_NONSEQ32,
+	GBA_WAIT_PREFETCH_NONSEQ16,
+	GBA_WAIT_MAX
+};
+
+/*
+预取缓冲的近似
+从卡带执行且打开预取时，卡带总线在非卡带的数据访问期间空闲，预取单元每1+S16个周期读入一个半字，最多8个，
+之后从缓冲取指只需1个周期。不跟踪缓冲的内容，而是在数据访问时预先扣除之后取指节省的周期：
+按访问占用的周期数查prefetchCredit，最多扣除8个半字的S16。卡带的数据访问占用总线，不扣除
+缓冲被跳转丢弃、或被连续的数据访问填满后仍继续扣除，这两种情况高估了缓冲的作用
+*/
+#define GBA_PREFETCH_HALFWORDS 8
+#define GBA_PREFETCH_MAX_CYCLES (GBA_PREFETCH_HALFWORDS * 9) //S16最大为8
+
 struct GBAMemory {
 	//内存区域基址
 	uint32_t* bios;				//0x00000000-0x00003FFF   BIOS - System ROM (16 KBytes)
@@ -162,14 +194,28 @@ struct GBAMemory {
 	 *How long each stall is depends on which region of memory is being accessed.
 	 *The GBA refers to these stalls as “wait states”.
 	*/
-	char waitstatesSeq32[256];
-	char waitstatesSeq16[256];
-	char waitstatesNonseq32[256];
-	char waitstatesNonseq16[256];
-	char waitstatesPrefetchSeq32[16];
-	char waitstatesPrefetchSeq16[16];
-	char waitstatesPrefetchNonseq32[16];
-	char waitstatesPrefetchNonseq16[16];
+	//按地址[31:24]位和访问类型索引，由GBAMemoryInit和GBAAdjustWaitstates生成
+	char waitstates[256][GBA_WAIT_MAX];
+	bool prefetch;			//WAITCNT的第14位
+	//WS0、WS1、WS2三个卡带区域各一张，由GBAAdjustWaitstates生成，按访问占用的周期数索引
+	int8_t prefetchCredit[3][GBA_PREFETCH_MAX_CYCLES + 1];
+	//当前执行区域使用的表，不从卡带执行或没有打开预取时是全零的表
+	const int8_t* activePrefetchCredit;
+	//可写内存每页的代数，每次写入时加一，预解码块缓存据此判断块是否失效
+	uint32_t wramGenerations[SIZE_WORKING_RAM >> ARM_BLOCK_CACHE_PAGE_BITS];
+	uint32_t iwramGenerations[SIZE_WORKING_IRAM >> ARM_BLOCK_CACHE_PAGE_BITS];
+
+	/*
+	被写入过的页（每页256字节）的位图，第n页对应word[n >> 5]的第(n & 31)位
+	没有订阅者时不记录；有订阅者时WRAM、IWRAM和VRAM的写入不走快速路径，全部由GBAStore*记录
+	*/
+	int dirtySubscribers;
+	uint32_t wramDirty[GBA_DIRTY_WORDS(SIZE_WORKING_RAM)];
+	uint32_t iwramDirty[GBA_DIRTY_WORDS(SIZE_WORKING_IRAM)];
+	uint32_t paletteDirty[GBA_DIRTY_WORDS(SIZE_PALETTE_RAM)];
+	uint32_t vramDirty[GBA_DIRTY_WORDS(SIZE_VRAM)];
+	uint32_t oamDirty[GBA_DIRTY_WORDS(SIZE_OAM)];
+
 	int activeRegion;		//当前使用的GBA内存区域，BIOS、WRAM、IWRAM、I/O Registers...，取值为0x0、0x2、0x3...
 	uint32_t biosPrefetch;
 
@@ -198,6 +244,13 @@ uint32_t GBALoadMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum L
 uint32_t GBAStoreMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum LSMDirection direction, int* cycleCounter);
 
 void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters);
+void GBAMemoryUpdateFastRegions(struct GBA* gba);
+
+void GBAMemorySubscribeDirty(struct GBA* gba);
+void GBAMemoryUnsubscribeDirty(struct GBA* gba);
+const uint32_t* GBAMemoryGetDirtyBitmap(const struct GBAMemory* memory, enum GBAMemoryRegion region, size_t* pages);
+void GBAMemoryClearDirty(struct GBAMemory* memory);
+void GBAMemoryMarkAllDirty(struct GBAMemory* memory);
 
 void GBAMemoryWriteDMASAD(struct GBA* gba, int dma, uint32_t address);
 void GBAMemoryWriteDMADAD(struct GBA* gba, int dma, uint32_t address);
@@ -208,7 +261,8 @@ void GBAMemoryScheduleDMA(struct GBA* gba, int number, struct GBADMA* info);
 void GBAMemoryRunHblankDMAs(struct GBA* gba, int32_t cycles);
 void GBAMemoryRunVblankDMAs(struct GBA* gba, int32_t cycles);
 void GBAMemoryUpdateDMAs(struct GBA* gba, int32_t cycles);
-int32_t GBAMemoryRunDMAs(struct GBA* gba, int32_t cycles);
+int32_t GBAMemoryRunDMAs(struct GBA* gba, int32_t cycles, int32_t budget);
+bool GBAMemoryFeedFIFO(struct GBA* gba, int number);
 
 struct GBASerializedState;
 void GBAMemorySerialize(struct GBAMemory* memory, struct GBASerializedState* state);
@@ -0,0 +1,197 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "gba-resampler.h"
+
+#include <math.h>
+
+#define CENTER (GBA_RESAMPLER_TAPS / 2 - 1)
+#define MIN_RATIO 0.125f
+#define PASSBAND 0.9f
+#define CUTOFF_TOLERANCE 0.02f
+
+static const char* const _qualityNames[GBA_RESAMPLER_QUALITY_MAX] = {
+	[GBA_RESAMPLER_NEAREST] = "nearest",
+	[GBA_RESAMPLER_LINEAR] = "linear",
+	[GBA_RESAMPLER_SINC] = "sinc"
+};
+
+static double _sinc(double x) {
+	if (x == 0) {
+		return 1;
+	}
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+static void _buildKernel(struct GBAResampler* resampler) {
+	int phase;
+	for (phase = 0; phase < GBA_RESAMPLER_PHASES; ++phase) {
+		double offset = phase / (double) GBA_RESAMPLER_PHASES;
+		double taps[GBA_RESAMPLER_TAPS];
+		double sum = 0;
+		int i;
+		for (i = 0; i < GBA_RESAMPLER_TAPS; ++i) {
+			double x = i - CENTER - offset;
+			// Lanczos窗，窗宽等于滤波器长度
+			double window = _sinc(x / (GBA_RESAMPLER_TAPS / 2));
+			if (fabs(x) >= GBA_RESAMPLER_TAPS / 2) {
+				window = 0;
+			}
+			taps[i] = resampler->cutoff * _sinc(resampler->cutoff * x) * window;
+			sum += taps[i];
+		}
+
+		// 逐相位归一化，舍入误差加到最大的系数上，保证直流增益恰好为1
+		int total = 0;
+		int largest = 0;
+		for (i = 0; i < GBA_RESAMPLER_TAPS; ++i) {
+			int16_t coefficient = lround(taps[i] / sum * (1 << GBA_RESAMPLER_COEFFICIENT_BITS));
+			resampler->kernel[phase][i] = coefficient;
+			total += coefficient;
+			if (coefficient > resampler->kernel[phase][largest]) {
+				largest = i;
+			}
+		}
+		resampler->kernel[phase][largest] += (1 << GBA_RESAMPLER_COEFFICIENT_BITS) - total;
+	}
+}
+
+void GBAResamplerInit(struct GBAResampler* resampler, enum GBAResamplerQuality quality) {
+	resampler->quality = quality;
+	resampler->ratio = 0;
+	resampler->cutoff = 0;
+	resampler->fraction = 0;
+	resampler->index = 0;
+	// 预先填入窗口前半部分的静音，第一个输出样本恰好对齐第一个输入样本
+	resampler->size = CENTER;
+	memset(resampler->left, 0, sizeof(resampler->left));
+	memset(resampler->right, 0, sizeof(resampler->right));
+	GBAResamplerSetRatio(resampler, 1.f);
+}
+
+void GBAResamplerSetRatio(struct GBAResampler* resampler, float ratio) {
+	if (ratio < MIN_RATIO) {
+		ratio = MIN_RATIO;
+	}
+	if (ratio == resampler->ratio) {
+		return;
+	}
+	resampler->ratio = ratio;
+	resampler->step = 65536.f / ratio + 0.5f;
+	if (!resampler->step) {
+		resampler->step = 1;
+	}
+
+	// 升采样时截止频率不变；速率控制带来的微小变化也不值得重建kernel
+	float cutoff = PASSBAND * (ratio < 1.f ? ratio : 1.f);
+	if (fabsf(cutoff - resampler->cutoff) > resampler->cutoff * CUTOFF_TOLERANCE && resampler->quality == GBA_RESAMPLER_SINC) {
+		resampler->cutoff = cutoff;
+		_buildKernel(resampler);
+	}
+}
+
+static unsigned _refill(struct GBAResampler* resampler, GBAResamplerSource source, void* context, unsigned remaining) {
+	unsigned kept = resampler->size - resampler->index;
+	memmove(resampler->left, &resampler->left[resampler->index], kept * sizeof(*resampler->left));
+	memmove(resampler->right, &resampler->right[resampler->index], kept * sizeof(*resampler->right));
+	resampler->index = 0;
+
+	// 只读入剩下的输出样本用得到的输入，其余留在来源中，速率控制看到的缓冲区填充程度才准确
+	uint64_t needed = ((resampler->fraction + (uint64_t) (remaining - 1) * resampler->step) >> 16) + GBA_RESAMPLER_TAPS;
+	unsigned wanted = GBA_RESAMPLER_BLOCK + GBA_RESAMPLER_TAPS - kept;
+	if (needed - kept < wanted) {
+		wanted = needed - kept;
+	}
+	int32_t* left = &resampler->left[kept];
+	int32_t* right = &resampler->right[kept];
+	unsigned read = source(context, left, right, wanted);
+	unsigned i;
+	// 限制到16位，累加时就不会溢出
+	for (i = 0; i < read; ++i) {
+		if (left[i] > INT16_MAX) {
+			left[i] = INT16_MAX;
+		} else if (left[i] < INT16_MIN) {
+			left[i] = INT16_MIN;
+		}
+		if (right[i] > INT16_MAX) {
+			right[i] = INT16_MAX;
+		} else if (right[i] < INT16_MIN) {
+			right[i] = INT16_MIN;
+		}
+	}
+	resampler->size = kept + read;
+	return read;
+}
+
+static int16_t _clamp(int32_t sample) {
+	if (sample > INT16_MAX) {
+		return INT16_MAX;
+	}
+	if (sample < INT16_MIN) {
+		return INT16_MIN;
+	}
+	return sample;
+}
+
+static void _filter(const struct GBAResampler* resampler, struct GBAStereoSample* output) {
+	const int32_t* left = &resampler->left[resampler->index];
+	const int32_t* right = &resampler->right[resampler->index];
+	switch (resampler->quality) {
+	case GBA_RESAMPLER_NEAREST: {
+		int i = CENTER + (resampler->fraction >= 0x8000);
+		output->left = left[i];
+		output->right = right[i];
+		break;
+	}
+	case GBA_RESAMPLER_LINEAR: {
+		int32_t fraction = resampler->fraction >> 2;
+		output->left = left[CENTER] + (((left[CENTER + 1] - left[CENTER]) * fraction) >> 14);
+		output->right = right[CENTER] + (((right[CENTER + 1] - right[CENTER]) * fraction) >> 14);
+		break;
+	}
+	case GBA_RESAMPLER_SINC:
+	default: {
+		const int16_t* kernel = resampler->kernel[resampler->fraction >> (16 - GBA_RESAMPLER_PHASE_BITS)];
+		int32_t sumLeft = 0;
+		int32_t sumRight = 0;
+		int i;
+		for (i = 0; i < GBA_RESAMPLER_TAPS; ++i) {
+			sumLeft += left[i] * kernel[i];
+			sumRight += right[i] * kernel[i];
+		}
+		int32_t round = 1 << (GBA_RESAMPLER_COEFFICIENT_BITS - 1);
+		output->left = _clamp((sumLeft + round) >> GBA_RESAMPLER_COEFFICIENT_BITS);
+		output->right = _clamp((sumRight + round) >> GBA_RESAMPLER_COEFFICIENT_BITS);
+		break;
+	}
+	}
+}
+
+unsigned GBAResamplerProcess(struct GBAResampler* resampler, GBAResamplerSource source, void* context, struct GBAStereoSample* output, unsigned nSamples) {
+	unsigned produced;
+	for (produced = 0; produced < nSamples; ++produced) {
+		if (resampler->index + GBA_RESAMPLER_TAPS > resampler->size) {
+			_refill(resampler, source, context, nSamples - produced);
+			if (resampler->index + GBA_RESAMPLER_TAPS > resampler->size) {
+				// 输入不足，剩余部分输出静音，已读入的样本留到下次
+				memset(&output[produced], 0, (nSamples - produced) * sizeof(*output));
+				break;
+			}
+		}
+		_filter(resampler, &output[produced]);
+		resampler->fraction += resampler->step;
+		resampler->index += resampler->fraction >> 16;
+		resampler->fraction &= 0xFFFF;
+	}
+	return produced;
+}
+
+const char* GBAResamplerQualityName(enum GBAResamplerQuality quality) {
+	if (quality >= GBA_RESAMPLER_QUALITY_MAX) {
+		return 0;
+	}
+	return _qualityNames[quality];
+}
@@ -0,0 +1,55 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_RESAMPLER_H
+#define GBA_RESAMPLER_H
+
+#include "util/common.h"
+
+#define GBA_RESAMPLER_TAPS 16
+#define GBA_RESAMPLER_PHASE_BITS 8
+#define GBA_RESAMPLER_PHASES (1 << GBA_RESAMPLER_PHASE_BITS)
+#define GBA_RESAMPLER_BLOCK 512
+#define GBA_RESAMPLER_COEFFICIENT_BITS 12
+
+struct GBAStereoSample {
+	int16_t left;
+	int16_t right;
+};
+
+enum GBAResamplerQuality {
+	GBA_RESAMPLER_NEAREST = 0,
+	GBA_RESAMPLER_LINEAR,
+	GBA_RESAMPLER_SINC,		//窗函数sinc的多相滤波器，降采样时截止频率随之降低
+	GBA_RESAMPLER_QUALITY_MAX
+};
+
+// 读取最多nSamples个输入样本，返回实际读出的个数
+typedef unsigned (*GBAResamplerSource)(void* context, int32_t* left, int32_t* right, unsigned nSamples);
+
+/*
+定点重采样器，位置是输入样本的16.16定点数
+输出样本位于left[index + TAPS / 2 - 1]之后fraction处，使用left[index]到left[index + TAPS - 1]，因此有TAPS / 2个输入样本的延迟
+*/
+struct GBAResampler {
+	enum GBAResamplerQuality quality;
+	float ratio;			//输出采样率与输入采样率之比
+	float cutoff;			//kernel的截止频率，相对输入的奈奎斯特频率
+	uint32_t step;			//每个输出样本前进的输入样本数，16.16定点
+	uint32_t fraction;
+	unsigned index;
+	unsigned size;			//left、right中有效的输入样本数
+	int32_t left[GBA_RESAMPLER_BLOCK + GBA_RESAMPLER_TAPS];
+	int32_t right[GBA_RESAMPLER_BLOCK + GBA_RESAMPLER_TAPS];
+	int16_t kernel[GBA_RESAMPLER_PHASES][GBA_RESAMPLER_TAPS];
+};
+
+void GBAResamplerInit(struct GBAResampler* resampler, enum GBAResamplerQuality quality);
+void GBAResamplerSetRatio(struct GBAResampler* resampler, float ratio);
+unsigned GBAResamplerProcess(struct GBAResampler* resampler, GBAResamplerSource source, void* context, struct GBAStereoSample* output, unsigned nSamples);
+
+const char* GBAResamplerQualityName(enum GBAResamplerQuality quality);
+
+#endif
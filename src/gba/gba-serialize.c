@@ -40,6 +40,10 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	memcpy(state->cpu.bankedRegisters, gba->cpu->bankedRegisters, 6 * 7 * sizeof(int32_t));
 	memcpy(state->cpu.bankedSPSRs, gba->cpu->bankedSPSRs, 6 * sizeof(int32_t));
 
+	int i;
+	for (i = 0; i < GBA_EVENT_MAX; ++i) {
+		GBASyncEventSource(gba, i);
+	}
 	GBAMemorySerialize(&gba->memory, state);
 	GBAIOSerialize(gba, state);
 	GBAVideoSerialize(&gba->video, state);
@@ -71,6 +75,11 @@ void GBADeserialize(struct GBA* gba, struct GBASerializedState* state) {
 	if (state->romCrc32 != gba->romCrc32) {
 		GBALog(gba, GBA_LOG_WARN, "Savestate is for a different version of the game");
 	}
+	// 载入前的状态也要先算上累计的周期，回写寄存器时与直接处理事件的结果一致
+	int i;
+	for (i = 0; i < GBA_EVENT_MAX; ++i) {
+		GBASyncEventSource(gba, i);
+	}
 	memcpy(gba->cpu->gprs, state->cpu.gprs, sizeof(gba->cpu->gprs));
 	gba->cpu->cpsr = state->cpu.cpsr;
 	gba->cpu->spsr = state->cpu.spsr;
@@ -88,10 +97,16 @@ void GBADeserialize(struct GBA* gba, struct GBASerializedState* state) {
 		LOAD_32(gba->cpu->prefetch, (gba->cpu->gprs[ARM_PC] - WORD_SIZE_ARM) & gba->cpu->memory.activeMask, gba->cpu->memory.activeRegion);
 	}
 
+	gba->idleLoopCandidate = -1;
+	gba->idleDetectionStep = 0;
+
 	GBAMemoryDeserialize(&gba->memory, state);
 	GBAIODeserialize(gba, state);
+	// 回写寄存器时会按载入前的计时器和DMA状态调整nextEvent，以存档中的值为准
+	gba->cpu->nextEvent = state->cpu.nextEvent;
 	GBAVideoDeserialize(&gba->video, state);
 	GBAAudioDeserialize(&gba->audio, state);
+	GBAResetEventSources(gba);
 
 	if (GBARRIsRecording(gba->rr)) {
 		if (state->associatedStreamId != gba->rr->streamId) {
@@ -228,11 +243,11 @@ bool GBALoadStateNamed(struct GBA* gba, struct VFile* vf) {
 }
 
 struct GBASerializedState* GBAAllocateState(void) {
-	return anonymousMemoryMap(sizeof(struct GBASerializedState));
+	return residentMemoryMap(sizeof(struct GBASerializedState));
 }
 
 void GBADeallocateState(struct GBASerializedState* state) {
-	mappedMemoryFree(state, sizeof(struct GBASerializedState));
+	residentMemoryFree(state, sizeof(struct GBASerializedState));
 }
 
 void GBARecordFrame(struct GBAThread* thread) {
@@ -21,6 +21,15 @@ static struct GBASIODriver* _lookupDriver(struct GBASIO* sio, enum GBASIOMode mo
 	}
 }
 
+// 驱动的下一个事件可能随寄存器改变而无从得知，下一次处理事件时调用它；没有驱动时SIO没有事件
+static void _scheduleDriver(struct GBASIO* sio) {
+	if (sio->activeDriver && sio->activeDriver->processEvents) {
+		GBAScheduleEventSource(sio->p, GBA_EVENT_SIO, sio->p->cpu->nextEvent);
+	} else {
+		GBACancelEventSource(sio->p, GBA_EVENT_SIO);
+	}
+}
+
 static void _switchMode(struct GBASIO* sio) {
 	unsigned mode = ((sio->rcnt >> 14) & 0xC) | ((sio->siocnt >> 12) & 0x3);
 	enum GBASIOMode oldMode = sio->mode;
@@ -37,6 +46,7 @@ static void _switchMode(struct GBASIO* sio) {
 		if (sio->activeDriver && sio->activeDriver->load) {
 			sio->activeDriver->load(sio->activeDriver);
 		}
+		_scheduleDriver(sio);
 	}
 }
 
@@ -83,6 +93,7 @@ void GBASIOSetDriver(struct GBASIO* sio, struct GBASIODriver* driver, enum GBASI
 		GBALog(sio->p, GBA_LOG_ERROR, "Setting an unsupported SIO driver: %x", mode);
 		return;
 	}
+	GBASyncEventSource(sio->p, GBA_EVENT_SIO);
 	if (*driverLoc) {
 		if ((*driverLoc)->unload) {
 			(*driverLoc)->unload(*driverLoc);
@@ -109,28 +120,35 @@ void GBASIOSetDriver(struct GBASIO* sio, struct GBASIODriver* driver, enum GBASI
 		}
 	}
 	*driverLoc = driver;
+	_scheduleDriver(sio);
 }
 
 void GBASIOWriteRCNT(struct GBASIO* sio, uint16_t value) {
+	GBASyncEventSource(sio->p, GBA_EVENT_SIO);
 	sio->rcnt = value;
 	_switchMode(sio);
 	if (sio->activeDriver && sio->activeDriver->writeRegister) {
 		sio->activeDriver->writeRegister(sio->activeDriver, REG_RCNT, value);
 	}
+	_scheduleDriver(sio);
 }
 
 void GBASIOWriteSIOCNT(struct GBASIO* sio, uint16_t value) {
+	GBASyncEventSource(sio->p, GBA_EVENT_SIO);
 	if (sio->activeDriver && sio->activeDriver->writeRegister) {
 		value = sio->activeDriver->writeRegister(sio->activeDriver, REG_SIOCNT, value);
 	}
 	sio->siocnt = value;
 	_switchMode(sio);
+	_scheduleDriver(sio);
 }
 
 void GBASIOWriteSIOMLT_SEND(struct GBASIO* sio, uint16_t value) {
+	GBASyncEventSource(sio->p, GBA_EVENT_SIO);
 	if (sio->activeDriver && sio->activeDriver->writeRegister) {
 		sio->activeDriver->writeRegister(sio->activeDriver, REG_SIOMLT_SEND, value);
 	}
+	_scheduleDriver(sio);
 }
 
 int32_t GBASIOProcessEvents(struct GBASIO* sio, int32_t cycles) {
@@ -31,7 +31,7 @@ struct GBASIODriver {
 	int (*load)(struct GBASIODriver* driver);
 	int (*unload)(struct GBASIODriver* driver);
 	int (*writeRegister)(struct GBASIODriver* driver, uint32_t address, uint16_t value);
-	int32_t (*processEvents)(struct GBASIODriver* driver, int32_t cycles);
+	int32_t (*processEvents)(struct GBASIODriver* driver, int32_t cycles);		//只在返回值到期或寄存器写入后调用，cycles是此间累计的周期数
 };
 
 struct GBASIODriverSet {
@@ -6,12 +6,17 @@
 #include "gba-thread.h"
 
 #include "arm.h"
+#ifdef USE_JIT
+#include "jit.h"
+#endif
 #include "gba.h"
 #include "gba-config.h"
 #include "gba-serialize.h"
 
 #include "debugger/debugger.h"
+#include "debugger/profiler.h"
 
+#include "util/memory.h"
 #include "util/patch.h"
 #include "util/png-io.h"
 #include "util/vfs.h"
@@ -105,7 +110,7 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 	struct ARMCore cpu;
 	struct Patch patch;
 	struct GBAThread* threadContext = context;
-	struct ARMComponent* components[1] = {};
+	struct ARMComponent* components[4] = {};
 	int numComponents = 0;
 
 	if (threadContext->debugger) {
@@ -113,6 +118,31 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 		++numComponents;
 	}
 
+#ifdef USE_JIT
+	// 调试器需要逐条检查断点，因此只在没有调试器时使用JIT
+	struct ARMJIT jit;
+	if (threadContext->useJIT && !threadContext->debugger) {
+		ARMJITCreate(&jit);
+		components[numComponents] = &jit.d;
+		++numComponents;
+	}
+#endif
+
+	// 分析器逐条执行指令，和调试器一样会绕过JIT和块缓存
+	struct ARMProfiler profiler;
+	if (threadContext->profile && !threadContext->debugger) {
+		ARMProfilerCreate(&profiler, threadContext->profile);
+		components[numComponents] = &profiler.d;
+		++numComponents;
+	}
+
+	struct ARMBlockCache blockCache;
+	if (threadContext->useBlockCache && !threadContext->debugger) {
+		ARMBlockCacheCreate(&blockCache);
+		components[numComponents] = &blockCache.d;
+		++numComponents;
+	}
+
 #if !defined(_WIN32) && defined(USE_PTHREADS)
 	sigset_t signals;
 	sigemptyset(&signals);
@@ -131,11 +161,10 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 	TlsSetValue(_contextKey, threadContext);
 #endif
 
-	if (threadContext->audioBuffers) {
-		GBAAudioResizeBuffer(&gba.audio, threadContext->audioBuffers);
-	} else {
+	if (!threadContext->audioBuffers) {
 		threadContext->audioBuffers = GBA_AUDIO_SAMPLES;
 	}
+	GBAAudioResizeBuffer(&gba.audio, threadContext->audioBuffers);
 
 	if (threadContext->renderer) {
 		GBAVideoAssociateRenderer(&gba.video, threadContext->renderer);
@@ -154,6 +183,20 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 
 	ARMReset(&cpu);
 
+#ifdef USE_JIT
+	if (threadContext->useJIT && !threadContext->debugger) {
+		GBAAttachJIT(&gba, &jit);
+	}
+#endif
+
+	if (threadContext->profile && !threadContext->debugger) {
+		GBAAttachProfiler(&gba, &profiler);
+	}
+
+	if (threadContext->useBlockCache && !threadContext->debugger) {
+		GBAAttachBlockCache(&gba, &blockCache);
+	}
+
 	if (threadContext->debugger) {
 		threadContext->debugger->log = GBADebuggerLogShim;
 		GBAAttachDebugger(&gba, threadContext->debugger);
@@ -179,6 +222,20 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 			}
 		} else {
 			while (threadContext->state == THREAD_RUNNING) {
+				if (gba.profiler) {
+					ARMProfilerRunLoop(gba.profiler);
+					continue;
+				}
+#ifdef USE_JIT
+				if (gba.jit) {
+					ARMJITRunLoop(gba.jit);
+					continue;
+				}
+#endif
+				if (gba.blockCache) {
+					ARMBlockCacheRunLoop(gba.blockCache);
+					continue;
+				}
 				ARMRunLoop(&cpu);
 			}
 		}
@@ -205,6 +262,9 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 		MutexUnlock(&threadContext->stateMutex);
 		if (resetScheduled) {
 			ARMReset(&cpu);
+			if (gba.blockCache) {
+				GBAAttachBlockCache(&gba, gba.blockCache);
+			}
 		}
 	}
 
@@ -212,6 +272,7 @@ static THREAD_ENTRY _GBAThreadRun(void* context) {
 		_changeState(threadContext, THREAD_SHUTDOWN, false);
 	}
 
+	GBAAudioFlushStream(&gba.audio, threadContext->stream);
 	if (threadContext->cleanCallback) {
 		threadContext->cleanCallback(threadContext);
 	}
@@ -235,6 +296,17 @@ void GBAMapOptionsToContext(const struct GBAOptions* opts, struct GBAThread* thr
 	threadContext->rewindBufferInterval = opts->rewindBufferInterval;
 	threadContext->sync.audioWait = opts->audioSync;
 	threadContext->sync.videoFrameWait = opts->videoSync;
+	threadContext->sync.audioRateControl = opts->audioRateControl;
+	threadContext->useJIT = opts->useJIT;
+	threadContext->useBlockCache = opts->useBlockCache;
+
+	// 分配策略对整个进程有效，需要在线程启动、分配内存之前设置
+	struct MemoryMapPolicy policy = {
+		.hugePages = opts->hugePages,
+		.populate = opts->prefaultMemory,
+		.lock = opts->lockMemory
+	};
+	setMemoryMapPolicy(&policy);
 
 	if (opts->fpsTarget) {
 		threadContext->fpsTarget = opts->fpsTarget;
@@ -257,6 +329,7 @@ void GBAMapArgumentsToContext(const struct GBAArguments* args, struct GBAThread*
 	}
 	threadContext->fname = args->fname;
 	threadContext->patch = VFileOpen(args->patch, O_RDONLY);
+	threadContext->profile = VFileOpen(args->profile, O_WRONLY | O_CREAT | O_TRUNC);
 }
 
 bool GBAThreadStart(struct GBAThread* threadContext) {
@@ -545,6 +618,29 @@ struct GBAThread* GBAThreadGetContext(void) {
 }
 #endif
 
+// 线程运行时需要先中断；暂存的音频先交给原来的stream，新的stream从下一个样本开始
+void GBAThreadSetStream(struct GBAThread* threadContext, struct GBAAVStream* stream) {
+	if (threadContext->gba) {
+		GBAAudioFlushStream(&threadContext->gba->audio, threadContext->stream);
+	}
+	threadContext->stream = stream;
+}
+
+// 兼容只实现了postAudioFrame的旧接收者
+void GBAAVStreamPostAudio(struct GBAAVStream* stream, const struct AudioFrame* samples, size_t nSamples) {
+	if (stream->postAudioBuffer) {
+		stream->postAudioBuffer(stream, samples, nSamples);
+		return;
+	}
+	if (!stream->postAudioFrame) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < nSamples; ++i) {
+		stream->postAudioFrame(stream, samples[i].left, samples[i].right);
+	}
+}
+
 #ifdef USE_PNG
 void GBAThreadTakeScreenshot(struct GBAThread* threadContext) {
 	unsigned stride;
@@ -589,6 +685,7 @@ void GBASyncPostFrame(struct GBASync* sync) {
 			GBARecordFrame(thread);
 		}
 	}
+	GBAAudioFlushStream(&thread->gba->audio, thread->stream);
 	if (thread->stream) {
 		thread->stream->postVideoFrame(thread->stream, thread->renderer);
 	}
@@ -635,8 +732,26 @@ void GBASyncResumeDrawing(struct GBASync* sync) {
 	_changeVideoSync(sync, true);
 }
 
-void GBASyncProduceAudio(struct GBASync* sync, bool wait) {
-	if (sync->audioWait && wait) {
+/*
+缓冲区满时由生产者调用，只有这时才加锁
+消费者读出和唤醒都在锁内进行，所以在锁内再检查一次缓冲区就不会错过唤醒
+*/
+// 缓冲区达到这个数量时生产者等待；开启速率控制时为GBAAudioControlRatio的目标，即半满，否则为整个缓冲区
+// 两种情况下都等于audioBuffers，见GBAAudioResizeBuffer
+size_t GBASyncAudioLimit(const struct GBASync* sync, const struct AudioRing* buffer) {
+	size_t capacity = AudioRingCapacity(buffer);
+	if (sync && sync->audioRateControl) {
+		return capacity / 2;
+	}
+	return capacity;
+}
+
+void GBASyncProduceAudio(struct GBASync* sync, const struct AudioRing* buffer) {
+	if (!sync->audioWait) {
+		return;
+	}
+	MutexLock(&sync->audioBufferMutex);
+	if (sync->audioWait && AudioRingSize(buffer) >= GBASyncAudioLimit(sync, buffer)) {
 		// TODO loop properly in event of spurious wakeups
 		ConditionWait(&sync->audioRequiredCond, &sync->audioBufferMutex);
 	}
@@ -11,6 +11,7 @@
 #include "gba.h"
 #include "gba-input.h"
 
+#include "util/audio-ring.h"
 #include "util/threading.h"
 
 struct GBAThread;
@@ -41,13 +42,15 @@ struct GBASync {
 	Condition videoFrameRequiredCond;
 
 	bool audioWait;
+	bool audioRateControl;		//生产者在缓冲区半满时等待，消费者按填充程度微调重采样比例
 	Condition audioRequiredCond;
-	Mutex audioBufferMutex;
+	Mutex audioBufferMutex;		//生产者在达到GBASyncAudioLimit时等待、消费者读出和调整缓冲区大小时使用
 };
 
 struct GBAAVStream {
 	void (*postVideoFrame)(struct GBAAVStream*, struct GBAVideoRenderer* renderer);
 	void (*postAudioFrame)(struct GBAAVStream*, int32_t left, int32_t right);
+	void (*postAudioBuffer)(struct GBAAVStream*, const struct AudioFrame* samples, size_t nSamples);	//为空时逐个样本调用postAudioFrame
 };
 
 struct GBAThread {
@@ -66,6 +69,7 @@ struct GBAThread {
 	struct VFile* save;
 	struct VFile* bios;
 	struct VFile* patch;
+	struct VFile* profile;
 	const char* fname;
 	int activeKeys;
 	struct GBAAVStream* stream;
@@ -74,6 +78,8 @@ struct GBAThread {
 	int frameskip;
 	float fpsTarget;
 	size_t audioBuffers;
+	bool useJIT;
+	bool useBlockCache;
 
 	// Threading state
 	Thread thread;
@@ -120,6 +126,9 @@ void GBAThreadTogglePause(struct GBAThread* threadContext);
 void GBAThreadPauseFromThread(struct GBAThread* threadContext);
 struct GBAThread* GBAThreadGetContext(void);
 
+void GBAThreadSetStream(struct GBAThread* threadContext, struct GBAAVStream* stream);
+void GBAAVStreamPostAudio(struct GBAAVStream* stream, const struct AudioFrame* samples, size_t nSamples);
+
 #ifdef USE_PNG
 void GBAThreadTakeScreenshot(struct GBAThread* threadContext);
 #endif
@@ -132,7 +141,8 @@ bool GBASyncDrawingFrame(struct GBASync* sync);
 void GBASyncSuspendDrawing(struct GBASync* sync);
 void GBASyncResumeDrawing(struct GBASync* sync);
 
-void GBASyncProduceAudio(struct GBASync* sync, bool wait);
+size_t GBASyncAudioLimit(const struct GBASync* sync, const struct AudioRing* buffer);
+void GBASyncProduceAudio(struct GBASync* sync, const struct AudioRing* buffer);
 void GBASyncLockAudio(struct GBASync* sync);
 void GBASyncUnlockAudio(struct GBASync* sync);
 void GBASyncConsumeAudio(struct GBASync* sync);
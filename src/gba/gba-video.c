@@ -28,6 +28,7 @@ static struct GBAVideoRenderer dummyRenderer = {
 	.reset = GBAVideoDummyRendererReset,
 	.deinit = GBAVideoDummyRendererDeinit,
 	.writeVideoRegister = GBAVideoDummyRendererWriteVideoRegister,
+	.writeVideoRegisters = GBAVideoRendererWriteVideoRegisters,
 	.writePalette = GBAVideoDummyRendererWritePalette,
 	.writeOAM = GBAVideoDummyRendererWriteOAM,
 	.drawScanline = GBAVideoDummyRendererDrawScanline,
@@ -54,9 +55,9 @@ void GBAVideoReset(struct GBAVideo* video) {
 	video->nextVcounterIRQ = 0;
 
 	if (video->vram) {
-		mappedMemoryFree(video->vram, SIZE_VRAM);
+		residentMemoryFree(video->vram, SIZE_VRAM);
 	}
-	video->vram = anonymousMemoryMap(SIZE_VRAM);
+	video->vram = residentMemoryMap(SIZE_VRAM);
 	video->renderer->vram = video->vram;
 
 	int i;
@@ -73,12 +74,16 @@ void GBAVideoReset(struct GBAVideo* video) {
 
 void GBAVideoDeinit(struct GBAVideo* video) {
 	GBAVideoAssociateRenderer(video, &dummyRenderer);
-	mappedMemoryFree(video->vram, SIZE_VRAM);
+	residentMemoryFree(video->vram, SIZE_VRAM);
 }
 
 void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer* renderer) {
 	video->renderer->deinit(video->renderer);
 	video->renderer = renderer;
+	// 没有实现批量写入的渲染器退回到逐个寄存器写入
+	if (!renderer->writeVideoRegisters) {
+		renderer->writeVideoRegisters = GBAVideoRendererWriteVideoRegisters;
+	}
 	renderer->palette = video->palette;
 	renderer->vram = video->vram;
 	renderer->oam = &video->oam;
@@ -169,6 +174,7 @@ void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value) {
 	video->dispstat |= value & 0xFFF8;
 
 	if (GBARegisterDISPSTATIsVcounterIRQ(video->dispstat)) {
+		GBASyncEventSource(video->p, GBA_EVENT_VIDEO);
 		// FIXME: this can be too late if we're in the middle of an Hblank
 		video->nextVcounterIRQ = video->nextHblank + VIDEO_HBLANK_LENGTH + (GBARegisterDISPSTATGetVcountSetting(video->dispstat) - video->vcount) * VIDEO_HORIZONTAL_LENGTH;
 		if (video->nextVcounterIRQ < video->nextEvent) {
@@ -192,6 +198,13 @@ static void GBAVideoDummyRendererDeinit(struct GBAVideoRenderer* renderer) {
 	// Nothing to do
 }
 
+void GBAVideoRendererWriteVideoRegisters(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t* values, size_t count) {
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		values[i] = renderer->writeVideoRegister(renderer, address + (i << 1), values[i]);
+	}
+}
+
 static uint16_t GBAVideoDummyRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	UNUSED(renderer);
 	UNUSED(address);
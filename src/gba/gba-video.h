@@ -156,6 +156,9 @@ struct GBAVideoRenderer {
 	void (*deinit)(struct GBAVideoRenderer* renderer);
 
 	uint16_t (*writeVideoRegister)(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+	//按地址递增顺序写入从address开始的count个寄存器，values改写为各寄存器实际保存的值
+	//没有专门实现时设为GBAVideoRendererWriteVideoRegisters，逐个调用writeVideoRegister
+	void (*writeVideoRegisters)(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t* values, size_t count);
 	void (*writePalette)(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 	void (*writeOAM)(struct GBAVideoRenderer* renderer, uint32_t oam);
 	void (*drawScanline)(struct GBAVideoRenderer* renderer, int y);
@@ -200,6 +203,8 @@ int32_t GBAVideoProcessEvents(struct GBAVideo* video, int32_t cycles);
 
 void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value);
 
+void GBAVideoRendererWriteVideoRegisters(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t* values, size_t count);
+
 struct GBASerializedState;
 void GBAVideoSerialize(struct GBAVideo* video, struct GBASerializedState* state);
 void GBAVideoDeserialize(struct GBAVideo* video, struct GBASerializedState* state);
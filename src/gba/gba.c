@@ -11,6 +11,10 @@
 #include "gba-sio.h"
 #include "gba-thread.h"
 
+#ifdef USE_JIT
+#include "jit.h"
+#endif
+
 #include "util/crc32.h"
 #include "util/memory.h"
 #include "util/patch.h"
@@ -22,6 +26,8 @@ const uint32_t GBA_COMPONENT_MAGIC = 0x1000000;
 static const size_t GBA_ROM_MAGIC_OFFSET = 2;
 static const uint8_t GBA_ROM_MAGIC[] = { 0x00, 0xEA };
 
+static const int32_t EVENT_SOURCE_MAX_DEFERRAL = 0x10000000;
+
 enum {
 	SP_BASE_SYSTEM = 0x03FFFF00,
 	SP_BASE_IRQ = 0x03FFFFA0,
@@ -109,6 +115,13 @@ static void GBAInit(struct ARMCore* cpu, struct ARMComponent* component);
 static void GBAInterruptHandlerInit(struct ARMInterruptHandler* irqh);
 static void GBAProcessEvents(struct ARMCore* cpu);
 static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles);
+static bool _timerIsLazy(struct GBA* gba, int timer);
+static void _skipTimerOverflows(struct GBATimer* timer, int32_t now);
+static int32_t _processVideo(struct GBA* gba, int32_t cycles);
+static int32_t _processAudio(struct GBA* gba, int32_t cycles);
+static int32_t _processDMA(struct GBA* gba, int32_t cycles);
+static int32_t _processSIO(struct GBA* gba, int32_t cycles);
+static void _runEventSource(struct GBA* gba, struct GBAEventSource* source);
 static void GBAHitStub(struct ARMCore* cpu, uint32_t opcode);
 static void GBAIllegal(struct ARMCore* cpu, uint32_t opcode);
 
@@ -124,6 +137,16 @@ static void GBAInit(struct ARMCore* cpu, struct ARMComponent* component) {
 	struct GBA* gba = (struct GBA*) component;
 	gba->cpu = cpu;
 	gba->debugger = 0;
+	gba->jit = 0;
+	gba->blockCache = 0;
+	gba->profiler = 0;
+
+	GBARegisterEventSource(gba, GBA_EVENT_VIDEO, _processVideo);
+	GBARegisterEventSource(gba, GBA_EVENT_AUDIO, _processAudio);
+	GBARegisterEventSource(gba, GBA_EVENT_TIMERS, GBATimersProcessEvents);
+	GBARegisterEventSource(gba, GBA_EVENT_DMA, _processDMA);
+	GBARegisterEventSource(gba, GBA_EVENT_SIO, _processSIO);
+	GBAResetEventSources(gba);
 
 	GBAInterruptHandlerInit(&cpu->irqh);
 	GBAMemoryInit(gba);
@@ -157,6 +180,12 @@ static void GBAInit(struct ARMCore* cpu, struct ARMComponent* component) {
 	gba->biosChecksum = GBAChecksum(gba->memory.bios, SIZE_BIOS);
 
 	gba->busyLoop = -1;
+	gba->idleLoopCandidate = -1;
+	gba->idleDetectionStep = 0;
+
+#ifdef USE_PERF_COUNTERS
+	GBAResetCounters(gba);
+#endif
 }
 
 void GBADestroy(struct GBA* gba) {
@@ -205,13 +234,18 @@ void GBAReset(struct ARMCore* cpu) {
 	GBAMemoryReset(gba);
 	GBAVideoReset(&gba->video);
 	GBAAudioReset(&gba->audio);
+	GBAResetEventSources(gba);
 	GBAIOInit(gba);
+	GBAMemoryUpdateFastRegions(gba);
 
 	GBASIODeinit(&gba->sio);
 	GBASIOInit(&gba->sio);
 
 	gba->timersEnabled = 0;
 	memset(gba->timers, 0, sizeof(gba->timers));
+
+	gba->idleLoopCandidate = -1;
+	gba->idleDetectionStep = 0;
 }
 
 //IRQ硬件中断处理程序
@@ -221,6 +255,7 @@ static void GBAProcessEvents(struct ARMCore* cpu) {
 		int32_t cycles = cpu->cycles;
 		int32_t nextEvent = INT_MAX;
 		int32_t testEvent;
+		GBA_COUNT(gba, eventLoops, 1);
 
 		gba->bus = cpu->prefetch;
 		if (cpu->executionMode == MODE_THUMB) {
@@ -232,51 +267,129 @@ static void GBAProcessEvents(struct ARMCore* cpu) {
 			gba->springIRQ = 0;
 		}
 
-		testEvent = GBAVideoProcessEvents(&gba->video, cycles);
-		if (testEvent < nextEvent) {
-			nextEvent = testEvent;
-		}
-
-		testEvent = GBAAudioProcessEvents(&gba->audio, cycles);
-		if (testEvent < nextEvent) {
-			nextEvent = testEvent;
-		}
-
-		testEvent = GBATimersProcessEvents(gba, cycles);
-		if (testEvent < nextEvent) {
-			nextEvent = testEvent;
-		}
-
-		testEvent = GBAMemoryRunDMAs(gba, cycles);
-		if (testEvent < nextEvent) {
-			nextEvent = testEvent;
-		}
-
-		testEvent = GBASIOProcessEvents(&gba->sio, cycles);
-		if (testEvent < nextEvent) {
-			nextEvent = testEvent;
+		int i;
+		for (i = 0; i < GBA_EVENT_MAX; ++i) {
+			struct GBAEventSource* source = &gba->eventSources[i];
+			source->pending += cycles;
+			if (source->pending >= source->nextEvent) {
+				_runEventSource(gba, source);
+			}
+			testEvent = source->nextEvent - source->pending;
+			if (testEvent < nextEvent) {
+				nextEvent = testEvent;
+			}
 		}
 
 		cpu->cycles -= cycles;
 		cpu->nextEvent = nextEvent;
 
 		if (cpu->halted) {
+			GBA_COUNT(gba, haltedCycles, cpu->nextEvent > cpu->cycles ? cpu->nextEvent - cpu->cycles : 0);
 			cpu->cycles = cpu->nextEvent;
 		}
 	} while (cpu->cycles >= cpu->nextEvent);
 }
 
+static int32_t _processVideo(struct GBA* gba, int32_t cycles) {
+	GBA_COUNT(gba, events[GBA_COUNTER_VIDEO], 1);
+	return GBAVideoProcessEvents(&gba->video, cycles);
+}
+
+static int32_t _processAudio(struct GBA* gba, int32_t cycles) {
+	GBA_COUNT(gba, events[GBA_COUNTER_AUDIO], 1);
+	return GBAAudioProcessEvents(&gba->audio, cycles);
+}
+
+// 突发传输不越过排在DMA之前的事件源的下一个事件；SIO在DMA之后处理，连接驱动时无法预知它的下一个事件，DMA不做突发传输
+static int32_t _processDMA(struct GBA* gba, int32_t cycles) {
+	int32_t budget = 0;
+	if (!gba->sio.activeDriver) {
+		budget = INT_MAX;
+		int i;
+		for (i = 0; i < GBA_EVENT_DMA; ++i) {
+			int32_t nextEvent = gba->eventSources[i].nextEvent - gba->eventSources[i].pending;
+			if (nextEvent < budget) {
+				budget = nextEvent;
+			}
+		}
+	}
+	return GBAMemoryRunDMAs(gba, cycles, budget);
+}
+
+static int32_t _processSIO(struct GBA* gba, int32_t cycles) {
+	if (gba->sio.activeDriver) {
+		GBA_COUNT(gba, events[GBA_COUNTER_SIO], 1);
+	}
+	return GBASIOProcessEvents(&gba->sio, cycles);
+}
+
+void GBARegisterEventSource(struct GBA* gba, enum GBAEventSourceId id, int32_t (*process)(struct GBA* gba, int32_t cycles)) {
+	gba->eventSources[id].process = process;
+	gba->eventSources[id].nextEvent = 0;
+	gba->eventSources[id].pending = 0;
+}
+
+// nextEvent为0表示下一次处理事件时一定调用，与子系统重置或读档后的行为一致
+void GBAResetEventSources(struct GBA* gba) {
+	int i;
+	for (i = 0; i < GBA_EVENT_MAX; ++i) {
+		gba->eventSources[i].nextEvent = 0;
+		gba->eventSources[i].pending = 0;
+	}
+}
+
+// 先清零，处理过程中（例如VBlank DMA写DISPSTAT）再次同步时不会重复计入
+// 没有事件的事件源也至少每EVENT_SOURCE_MAX_DEFERRAL个周期处理一次，pending不会溢出
+static void _runEventSource(struct GBA* gba, struct GBAEventSource* source) {
+	int32_t pending = source->pending;
+	source->pending = 0;
+	source->nextEvent = source->process(gba, pending);
+	if (source->nextEvent > EVENT_SOURCE_MAX_DEFERRAL) {
+		source->nextEvent = EVENT_SOURCE_MAX_DEFERRAL;
+	}
+}
+
+void GBASyncEventSource(struct GBA* gba, enum GBAEventSourceId id) {
+	struct GBAEventSource* source = &gba->eventSources[id];
+	if (source->pending) {
+		_runEventSource(gba, source);
+	}
+}
+
+// when与cpu->cycles同一基准，调用前事件源要已经同步
+void GBAScheduleEventSource(struct GBA* gba, enum GBAEventSourceId id, int32_t when) {
+	if (when >= EVENT_SOURCE_MAX_DEFERRAL) {
+		GBACancelEventSource(gba, id);
+		return;
+	}
+	struct GBAEventSource* source = &gba->eventSources[id];
+	source->nextEvent = source->pending + when;
+	if (when < gba->cpu->nextEvent) {
+		gba->cpu->nextEvent = when;
+	}
+}
+
+void GBACancelEventSource(struct GBA* gba, enum GBAEventSourceId id) {
+	struct GBAEventSource* source = &gba->eventSources[id];
+	source->nextEvent = source->pending + EVENT_SOURCE_MAX_DEFERRAL;
+}
+
 static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 	int32_t nextEvent = INT_MAX;
 	if (gba->timersEnabled) {
 		struct GBATimer* timer;
 		struct GBATimer* nextTimer;
+		bool lazy;
 
 		timer = &gba->timers[0];
 		if (timer->enable) {
 			timer->nextEvent -= cycles;
 			timer->lastEvent -= cycles;
-			if (timer->nextEvent <= 0) {
+			lazy = _timerIsLazy(gba, 0);
+			if (lazy) {
+				_skipTimerOverflows(timer, 0);
+			} else if (timer->nextEvent <= 0) {
+				GBA_COUNT(gba, events[GBA_COUNTER_TIMERS], 1);
 				timer->lastEvent = timer->nextEvent;
 				timer->nextEvent += timer->overflowInterval;
 				gba->memory.io[REG_TM0CNT_LO >> 1] = timer->reload;
@@ -304,14 +417,20 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 					}
 				}
 			}
-			nextEvent = timer->nextEvent;
+			if (!lazy) {
+				nextEvent = timer->nextEvent;
+			}
 		}
 
 		timer = &gba->timers[1];
 		if (timer->enable) {
 			timer->nextEvent -= cycles;
 			timer->lastEvent -= cycles;
-			if (timer->nextEvent <= 0) {
+			lazy = _timerIsLazy(gba, 1);
+			if (lazy) {
+				_skipTimerOverflows(timer, 0);
+			} else if (timer->nextEvent <= 0) {
+				GBA_COUNT(gba, events[GBA_COUNTER_TIMERS], 1);
 				timer->lastEvent = timer->nextEvent;
 				timer->nextEvent += timer->overflowInterval;
 				gba->memory.io[REG_TM1CNT_LO >> 1] = timer->reload;
@@ -343,7 +462,7 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 					}
 				}
 			}
-			if (timer->nextEvent < nextEvent) {
+			if (!lazy && timer->nextEvent < nextEvent) {
 				nextEvent = timer->nextEvent;
 			}
 		}
@@ -352,7 +471,11 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 		if (timer->enable) {
 			timer->nextEvent -= cycles;
 			timer->lastEvent -= cycles;
-			if (timer->nextEvent <= 0) {
+			lazy = _timerIsLazy(gba, 2);
+			if (lazy) {
+				_skipTimerOverflows(timer, 0);
+			} else if (timer->nextEvent <= 0) {
+				GBA_COUNT(gba, events[GBA_COUNTER_TIMERS], 1);
 				timer->lastEvent = timer->nextEvent;
 				timer->nextEvent += timer->overflowInterval;
 				gba->memory.io[REG_TM2CNT_LO >> 1] = timer->reload;
@@ -374,7 +497,7 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 					}
 				}
 			}
-			if (timer->nextEvent < nextEvent) {
+			if (!lazy && timer->nextEvent < nextEvent) {
 				nextEvent = timer->nextEvent;
 			}
 		}
@@ -383,7 +506,11 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 		if (timer->enable) {
 			timer->nextEvent -= cycles;
 			timer->lastEvent -= cycles;
-			if (timer->nextEvent <= 0) {
+			lazy = _timerIsLazy(gba, 3);
+			if (lazy) {
+				_skipTimerOverflows(timer, 0);
+			} else if (timer->nextEvent <= 0) {
+				GBA_COUNT(gba, events[GBA_COUNTER_TIMERS], 1);
 				timer->lastEvent = timer->nextEvent;
 				timer->nextEvent += timer->overflowInterval;
 				gba->memory.io[REG_TM3CNT_LO >> 1] = timer->reload;
@@ -397,7 +524,7 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 					timer->nextEvent = INT_MAX;
 				}
 			}
-			if (timer->nextEvent < nextEvent) {
+			if (!lazy && timer->nextEvent < nextEvent) {
 				nextEvent = timer->nextEvent;
 			}
 		}
@@ -405,14 +532,126 @@ static int32_t GBATimersProcessEvents(struct GBA* gba, int32_t cycles) {
 	return nextEvent;
 }
 
+// 溢出既不触发中断、不驱动级联计时器、也不给音频FIFO取样时，计数值只在读寄存器时按lastEvent推算，不必为每次溢出安排事件
+static bool _timerIsLazy(struct GBA* gba, int timer) {
+	struct GBATimer* currentTimer = &gba->timers[timer];
+	if (currentTimer->countUp || currentTimer->doIrq) {
+		return false;
+	}
+	if (timer < 3 && gba->timers[timer + 1].countUp) {
+		return false;
+	}
+	if (timer < 2 && gba->audio.enable) {
+		if ((gba->audio.chALeft || gba->audio.chARight) && gba->audio.chATimer == timer) {
+			return false;
+		}
+		if ((gba->audio.chBLeft || gba->audio.chBRight) && gba->audio.chBTimer == timer) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 把到now为止错过的溢出一次补齐，lastEvent落在最后一次溢出上
+static void _skipTimerOverflows(struct GBATimer* timer, int32_t now) {
+	if (timer->nextEvent > now) {
+		return;
+	}
+	int32_t missed = (now - timer->nextEvent) / timer->overflowInterval;
+	timer->lastEvent = timer->nextEvent + missed * timer->overflowInterval;
+	timer->nextEvent = timer->lastEvent + timer->overflowInterval;
+	timer->oldReload = timer->reload;
+}
+
+// 写入之后可能不再是惰性的，写入完成后要调用GBATimersSchedule
+// 事件循环照旧在它下一次溢出时停一下，空闲循环跳过和停机都以cpu->nextEvent为界
+void GBATimersCatchUp(struct GBA* gba) {
+	GBASyncEventSource(gba, GBA_EVENT_TIMERS);
+	int i;
+	for (i = 0; i < 4; ++i) {
+		struct GBATimer* timer = &gba->timers[i];
+		if (!timer->enable || timer->countUp || !_timerIsLazy(gba, i)) {
+			continue;
+		}
+		_skipTimerOverflows(timer, gba->cpu->cycles);
+		if (timer->nextEvent < gba->cpu->nextEvent) {
+			gba->cpu->nextEvent = timer->nextEvent;
+		}
+	}
+}
+
+// 与GBATimersProcessEvents的返回值相同：非惰性计时器中最早的溢出
+void GBATimersSchedule(struct GBA* gba) {
+	int32_t nextEvent = INT_MAX;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		struct GBATimer* timer = &gba->timers[i];
+		if (timer->enable && !_timerIsLazy(gba, i) && timer->nextEvent < nextEvent) {
+			nextEvent = timer->nextEvent;
+		}
+	}
+	GBAScheduleEventSource(gba, GBA_EVENT_TIMERS, nextEvent);
+}
+
 void GBAAttachDebugger(struct GBA* gba, struct ARMDebugger* debugger) {
 	gba->debugger = debugger;
+	GBAMemoryUpdateFastRegions(gba);
 }
 
 void GBADetachDebugger(struct GBA* gba) {
 	gba->debugger = 0;
+	GBAMemoryUpdateFastRegions(gba);
+}
+
+void GBAAttachProfiler(struct GBA* gba, struct ARMProfiler* profiler) {
+	gba->profiler = profiler;
+}
+
+#ifdef USE_PERF_COUNTERS
+void GBAGetCounters(struct GBA* gba, struct GBACounters* counters) {
+	*counters = gba->counters;
+	memcpy(counters->memoryAccesses, gba->cpu->memory.accessCounts, sizeof(counters->memoryAccesses));
+}
+
+void GBAResetCounters(struct GBA* gba) {
+	memset(&gba->counters, 0, sizeof(gba->counters));
+	memset(gba->cpu->memory.accessCounts, 0, sizeof(gba->cpu->memory.accessCounts));
+}
+#endif
+
+//BIOS和卡带ROM中的块永久有效，WRAM和IWRAM中的块按页的代数失效
+//重置后WRAM和IWRAM会重新映射，因此需要再次调用
+void GBAAttachBlockCache(struct GBA* gba, struct ARMBlockCache* cache) {
+	gba->blockCache = cache;
+	ARMBlockCacheClearRanges(cache);
+	ARMBlockCacheAddRange(cache, BASE_BIOS, BASE_BIOS + SIZE_BIOS, gba->memory.bios, 0);
+	ARMBlockCacheAddRange(cache, BASE_WORKING_RAM, BASE_WORKING_RAM + SIZE_WORKING_RAM, gba->memory.wram, gba->memory.wramGenerations);
+	ARMBlockCacheAddRange(cache, BASE_WORKING_IRAM, BASE_WORKING_IRAM + SIZE_WORKING_IRAM, gba->memory.iwram, gba->memory.iwramGenerations);
+	if (gba->memory.rom) {
+		ARMBlockCacheAddRange(cache, BASE_CART0, BASE_CART0 + gba->memory.romSize, gba->memory.rom, 0);
+		ARMBlockCacheAddRange(cache, BASE_CART1, BASE_CART1 + gba->memory.romSize, gba->memory.rom, 0);
+		ARMBlockCacheAddRange(cache, BASE_CART2, BASE_CART2 + gba->memory.romSize, gba->memory.rom, 0);
+	}
 }
 
+#ifdef USE_JIT
+//BIOS和卡带ROM在运行时不会被改写，可以交给JIT翻译
+void GBAAttachJIT(struct GBA* gba, struct ARMJIT* jit) {
+	if (!jit->code) {
+		// 初始化失败时不挂上JIT，线程退回到块缓存或解释器
+		GBALog(gba, GBA_LOG_WARN, "Couldn't allocate JIT code buffer");
+		return;
+	}
+	gba->jit = jit;
+	ARMJITAddStaticRange(jit, BASE_BIOS, BASE_BIOS + SIZE_BIOS, gba->memory.bios);
+	if (gba->memory.rom) {
+		ARMJITAddStaticRange(jit, BASE_CART0, BASE_CART0 + gba->memory.romSize, gba->memory.rom);
+		ARMJITAddStaticRange(jit, BASE_CART1, BASE_CART1 + gba->memory.romSize, gba->memory.rom);
+		ARMJITAddStaticRange(jit, BASE_CART2, BASE_CART2 + gba->memory.romSize, gba->memory.rom);
+	}
+}
+#endif
+
 void GBALoadROM(struct GBA* gba, struct VFile* vf, struct VFile* sav, const char* fname) {
 	gba->romVf = vf;
 	gba->pristineRomSize = vf->seek(vf, 0, SEEK_END);
@@ -422,6 +661,8 @@ void GBALoadROM(struct GBA* gba, struct VFile* vf, struct VFile* sav, const char
 		GBALog(gba, GBA_LOG_WARN, "Couldn't map ROM");
 		return;
 	}
+	// 映射了SIZE_CART0，文件末尾之后的页不能访问
+	mappedMemoryApplyPolicy(gba->pristineRom, gba->pristineRomSize);
 	gba->memory.rom = gba->pristineRom;
 	gba->activeFile = fname;
 	gba->memory.romSize = gba->pristineRomSize;
@@ -457,15 +698,33 @@ void GBALoadBIOS(struct GBA* gba, struct VFile* vf) {
 	// TODO: error check
 }
 
+/*
+ROM是文件的私有映射（MAP_PRIVATE，写时复制），补丁直接写入其中，只有被补丁改写的页才会复制
+补丁失败时重新映射文件，丢弃已经写入的页
+输出比ROM文件大时，文件末尾之后的页无法访问，仍然复制一份到匿名内存中
+*/
 void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 	size_t patchedSize = patch->outputSize(patch, gba->memory.romSize);
 	if (!patchedSize) {
 		return;
 	}
-	gba->memory.rom = anonymousMemoryMap(patchedSize);
+	if (gba->memory.rom == gba->pristineRom && patchedSize <= gba->pristineRomSize) {
+		if (!patch->applyPatch(patch, gba->memory.rom, patchedSize)) {
+			gba->romVf->unmap(gba->romVf, gba->pristineRom, SIZE_CART0);
+			gba->pristineRom = gba->romVf->map(gba->romVf, SIZE_CART0, MAP_READ);
+			mappedMemoryApplyPolicy(gba->pristineRom, gba->pristineRomSize);
+			gba->memory.rom = gba->pristineRom;
+			gba->memory.gpio.gpioBase = &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1];
+			return;
+		}
+		gba->memory.romSize = patchedSize;
+		gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+		return;
+	}
+	gba->memory.rom = residentMemoryMap(patchedSize);
 	memcpy(gba->memory.rom, gba->pristineRom, gba->memory.romSize > patchedSize ? patchedSize : gba->memory.romSize);
 	if (!patch->applyPatch(patch, gba->memory.rom, patchedSize)) {
-		mappedMemoryFree(gba->memory.rom, patchedSize);
+		residentMemoryFree(gba->memory.rom, patchedSize);
 		gba->memory.rom = gba->pristineRom;
 		return;
 	}
@@ -476,7 +735,13 @@ void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 void GBATimerUpdateRegister(struct GBA* gba, int timer) {
 	struct GBATimer* currentTimer = &gba->timers[timer];
 	if (currentTimer->enable && !currentTimer->countUp) {
+		GBASyncEventSource(gba, GBA_EVENT_TIMERS);
+		if (_timerIsLazy(gba, timer)) {
+			_skipTimerOverflows(currentTimer, gba->cpu->cycles);
+		}
 		gba->memory.io[(REG_TM0CNT_LO + (timer << 2)) >> 1] = currentTimer->oldReload + ((gba->cpu->cycles - currentTimer->lastEvent) >> currentTimer->prescaleBits);
+		// 计数值随周期变化，轮询计时器的循环不能跳过
+		gba->idleDetectionStep = -1;
 	}
 }
 
@@ -486,6 +751,7 @@ void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t reload) {
 
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 	struct GBATimer* currentTimer = &gba->timers[timer];
+	GBATimersCatchUp(gba);
 	GBATimerUpdateRegister(gba, timer);
 
 	int oldPrescale = currentTimer->prescaleBits;
@@ -531,6 +797,7 @@ void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 	if (currentTimer->nextEvent < gba->cpu->nextEvent) {
 		gba->cpu->nextEvent = currentTimer->nextEvent;
 	}
+	GBATimersSchedule(gba);
 };
 
 void GBAWriteIE(struct GBA* gba, uint16_t value) {
@@ -554,6 +821,7 @@ void GBAWriteIME(struct GBA* gba, uint16_t value) {
 }
 
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq) {
+	GBA_COUNT(gba, irqs[irq], 1);
 	gba->memory.io[REG_IF >> 1] |= 1 << irq;
 	gba->cpu->halted = 0;
 
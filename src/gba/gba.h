@@ -77,11 +77,64 @@ enum GBAKey {
 	GBA_KEY_NONE = -1
 };
 
+struct ARMJIT;
+struct ARMBlockCache;
+struct ARMProfiler;
 struct GBA;
 struct GBARotationSource;
 struct Patch;
 struct VFile;
 
+/*
+事件源：视频、音频、定时器、DMA和SIO，按这个顺序处理
+它们在未到期时被调用只会把剩余周期减去，因此GBAProcessEvents只在到期时调用它们，其余时间只把周期累计在pending中
+事件源内部的计数以上次调用process为基准，事件循环之外（寄存器读写、存档）读写之前要先调用GBASyncEventSource，之后与cpu->cycles同一基准
+改变了下一个事件后用GBAScheduleEventSource重新安排，不再有事件时用GBACancelEventSource
+*/
+enum GBAEventSourceId {
+	GBA_EVENT_VIDEO = 0,
+	GBA_EVENT_AUDIO,
+	GBA_EVENT_TIMERS,
+	GBA_EVENT_DMA,
+	GBA_EVENT_SIO,
+	GBA_EVENT_MAX
+};
+
+struct GBAEventSource {
+	int32_t (*process)(struct GBA* gba, int32_t cycles);
+	int32_t nextEvent;		//相对上次调用process的到期周期数
+	int32_t pending;		//上次调用process后累计、尚未交给process的周期数
+};
+
+/*
+性能计数器，仅在定义USE_PERF_COUNTERS时编译，未定义时GBA_COUNT展开为空
+memoryAccesses包括CPU数据访存（不含取指，JIT生成的代码不计入）和DMA的每次读写，按地址[27:24]位分区，由GBAGetCounters从cpu->memory.accessCounts合并
+*/
+#ifdef USE_PERF_COUNTERS
+enum GBACounterSubsystem {
+	GBA_COUNTER_VIDEO = 0,
+	GBA_COUNTER_AUDIO,
+	GBA_COUNTER_TIMERS,						//非惰性定时器的溢出
+	GBA_COUNTER_DMA,						//DMA服务次数（一次可能传输多个单元）
+	GBA_COUNTER_SIO,						//连接驱动时的SIO事件处理
+	GBA_COUNTER_SUBSYSTEM_MAX
+};
+
+struct GBACounters {
+	uint64_t eventLoops;					//GBAProcessEvents的循环次数
+	uint64_t events[GBA_COUNTER_SUBSYSTEM_MAX];
+	uint64_t dmaUnits[4];					//每个通道传输的单元数
+	uint64_t irqs[IRQ_GAMEPAK + 1];
+	uint64_t haltedCycles;					//停机时跳过的周期数
+	uint64_t memoryAccesses[ARM_FAST_REGION_COUNT];
+	uint64_t ioWrites[SIZE_IO >> 1];		//以半字为单位的I/O寄存器写入次数，32位写入计一次
+};
+
+#define GBA_COUNT(GBA, COUNTER, N) ((GBA)->counters.COUNTER += (N))
+#else
+#define GBA_COUNT(GBA, COUNTER, N)
+#endif
+
 struct GBATimer {
 	uint16_t reload;
 	uint16_t oldReload;
@@ -106,9 +159,14 @@ struct GBA {
 	struct GBASync* sync;
 
 	struct ARMDebugger* debugger;
+	struct ARMJIT* jit;
+	struct ARMBlockCache* blockCache;
+	struct ARMProfiler* profiler;
 
 	uint32_t bus;
 
+	struct GBAEventSource eventSources[GBA_EVENT_MAX];
+
 	int timersEnabled;
 	struct GBATimer timers[4];
 
@@ -116,10 +174,13 @@ struct GBA {
 	uint32_t biosChecksum;
 	int* keySource;
 	uint32_t busyLoop;
+	uint32_t idleLoopCandidate;		//最近一次同区域跳转的目标地址，跨区域跳转后为-1
+	int idleDetectionStep;			//0：第一次到达，1：已分析循环体并记录寄存器，-1：不是空闲循环
+	int32_t idleRegisters[16];		//上一次到达循环入口时的r0-r14和CPSR
 	struct GBARotationSource* rotationSource;
 	struct GBARumble* rumble;
 	struct GBARRContext* rr;
-	void* pristineRom;
+	void* pristineRom;				//ROM文件的私有映射，打补丁后其中是补丁的内容
 	size_t pristineRomSize;
 	uint32_t romCrc32;
 	struct VFile* romVf;
@@ -128,6 +189,10 @@ struct GBA {
 	const char* activeFile;
 
 	int logLevel;
+
+#ifdef USE_PERF_COUNTERS
+	struct GBACounters counters;
+#endif
 };
 
 //GBA 卡带
@@ -152,6 +217,8 @@ void GBADestroy(struct GBA* gba);
 void GBAReset(struct ARMCore* cpu);
 
 void GBATimerUpdateRegister(struct GBA* gba, int timer);
+void GBATimersCatchUp(struct GBA* gba);
+void GBATimersSchedule(struct GBA* gba);
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t value);
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t value);
 
@@ -160,10 +227,27 @@ void GBAWriteIME(struct GBA* gba, uint16_t value);
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq);
 void GBATestIRQ(struct ARMCore* cpu);
 void GBAHalt(struct GBA* gba);
+void GBARegisterEventSource(struct GBA* gba, enum GBAEventSourceId id, int32_t (*process)(struct GBA* gba, int32_t cycles));
+void GBAResetEventSources(struct GBA* gba);
+void GBASyncEventSource(struct GBA* gba, enum GBAEventSourceId id);
+void GBAScheduleEventSource(struct GBA* gba, enum GBAEventSourceId id, int32_t when);
+void GBACancelEventSource(struct GBA* gba, enum GBAEventSourceId id);
 
 void GBAAttachDebugger(struct GBA* gba, struct ARMDebugger* debugger);
 void GBADetachDebugger(struct GBA* gba);
 
+void GBAAttachBlockCache(struct GBA* gba, struct ARMBlockCache* cache);
+void GBAAttachProfiler(struct GBA* gba, struct ARMProfiler* profiler);
+
+#ifdef USE_PERF_COUNTERS
+void GBAGetCounters(struct GBA* gba, struct GBACounters* counters);
+void GBAResetCounters(struct GBA* gba);
+#endif
+
+#ifdef USE_JIT
+void GBAAttachJIT(struct GBA* gba, struct ARMJIT* jit);
+#endif
+
 void GBALoadROM(struct GBA* gba, struct VFile* vf, struct VFile* sav, const char* fname);
 void GBALoadBIOS(struct GBA* gba, struct VFile* vf);
 void GBAApplyPatch(struct GBA* gba, struct Patch* patch);
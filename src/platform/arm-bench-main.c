@@ -0,0 +1,461 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "arm.h"
+#include "decoder.h"
+#include "isa-inlines.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+/*
+ARM核心的指令级基准测试
+在一块平坦的内存上构建一个裸的ARMCore，不依赖GBA的其余部分
+对每个助记符随机生成一段只包含该类指令的指令流，末尾跳回开头，用ARMRunLoop反复执行
+输出CSV：每条指令的宿主纳秒数，以及每宿主秒执行的模拟周期数
+*/
+
+#define BENCH_OPTIONS "ATm:s:t:"
+#define BENCH_CODE_BASE 0x08000000
+#define BENCH_MEMORY_SIZE 0x10000
+#define BENCH_STREAM_LENGTH 512		//Thumb的无条件B只能向回跳2KB
+#define BENCH_MAX_ATTEMPTS 0x400000
+#define BENCH_MIN_UNIQUE 16		//乘法等编码稀疏的指令不够时重复已生成的指令
+#define BENCH_CHUNK_CYCLES 0x10000
+#define BENCH_CHUNKS_PER_CHECK 16
+
+struct ARMBench {
+	struct ARMComponent d;
+	uint8_t ram[BENCH_MEMORY_SIZE];
+	uint8_t code[BENCH_MEMORY_SIZE];	//位于BENCH_CODE_BASE，写入会被忽略
+	uint32_t generations[BENCH_MEMORY_SIZE >> ARM_BLOCK_CACHE_PAGE_BITS];
+	uint32_t seed;
+	uint32_t branches;		//setActiveRegion的调用次数，即指令流循环的次数
+	uint64_t cycles;
+};
+
+struct BenchOpts {
+	bool arm;
+	bool thumb;
+	const char* mnemonic;
+	unsigned duration;
+};
+
+static uint32_t _random(struct ARMBench* bench) {
+	bench->seed ^= bench->seed << 13;
+	bench->seed ^= bench->seed >> 17;
+	bench->seed ^= bench->seed << 5;
+	return bench->seed;
+}
+
+static uint8_t* _region(struct ARMCore* cpu, uint32_t address) {
+	struct ARMBench* bench = (struct ARMBench*) cpu->master;
+	if ((address >> ARM_FAST_REGION_SHIFT) == (BENCH_CODE_BASE >> ARM_FAST_REGION_SHIFT)) {
+		return bench->code;
+	}
+	return bench->ram;
+}
+
+// 对齐的访问都会走快速路径，这里只处理未对齐的访问
+static int32_t _load32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	int32_t value;
+	LOAD_32(value, address & (BENCH_MEMORY_SIZE - 4), _region(cpu, address));
+	if (cycleCounter) {
+		*cycleCounter += 2;
+	}
+	return value;
+}
+
+static uint16_t _loadU16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	uint16_t value;
+	LOAD_16(value, address & (BENCH_MEMORY_SIZE - 2), _region(cpu, address));
+	if (cycleCounter) {
+		*cycleCounter += 2;
+	}
+	return value;
+}
+
+static int16_t _load16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	return _loadU16(cpu, address, cycleCounter);
+}
+
+static uint8_t _loadU8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	if (cycleCounter) {
+		*cycleCounter += 2;
+	}
+	return _region(cpu, address)[address & (BENCH_MEMORY_SIZE - 1)];
+}
+
+static int8_t _load8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	return _loadU8(cpu, address, cycleCounter);
+}
+
+static void _store32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter) {
+	struct ARMBench* bench = (struct ARMBench*) cpu->master;
+	if (_region(cpu, address) == bench->ram) {
+		STORE_32(value, address & (BENCH_MEMORY_SIZE - 4), bench->ram);
+	}
+	if (cycleCounter) {
+		*cycleCounter += 1;
+	}
+}
+
+static void _store16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
+	struct ARMBench* bench = (struct ARMBench*) cpu->master;
+	if (_region(cpu, address) == bench->ram) {
+		STORE_16(value, address & (BENCH_MEMORY_SIZE - 2), bench->ram);
+	}
+	if (cycleCounter) {
+		*cycleCounter += 1;
+	}
+}
+
+static void _store8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter) {
+	struct ARMBench* bench = (struct ARMBench*) cpu->master;
+	if (_region(cpu, address) == bench->ram) {
+		bench->ram[address & (BENCH_MEMORY_SIZE - 1)] = value;
+	}
+	if (cycleCounter) {
+		*cycleCounter += 1;
+	}
+}
+
+// 与GBALoadMultiple/GBAStoreMultiple的地址计算和返回值相同
+static uint32_t _transferMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter, bool load) {
+	int offset = 4;
+	int popcount = 0;
+	if (direction & LSM_D) {
+		offset = -4;
+		popcount = __builtin_popcount(mask);
+		address -= (popcount << 2) - 4;
+	}
+	if (direction & LSM_B) {
+		address += offset;
+	}
+	uint32_t addressMisalign = address & 0x3;
+	address &= 0xFFFFFFFC;
+
+	int i;
+	for (i = 0; i < 16; ++i) {
+		if (mask & (1 << i)) {
+			if (load) {
+				cpu->gprs[i] = _load32(cpu, address, cycleCounter);
+			} else {
+				_store32(cpu, address, cpu->gprs[i], cycleCounter);
+			}
+			address += 4;
+		}
+	}
+
+	if (direction & LSM_B) {
+		address -= offset;
+	}
+	if (direction & LSM_D) {
+		address -= (popcount << 2) + 4;
+	}
+	return address | addressMisalign;
+}
+
+static uint32_t _loadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter) {
+	return _transferMultiple(cpu, address, mask, direction, cycleCounter, true);
+}
+
+static uint32_t _storeMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter) {
+	return _transferMultiple(cpu, address, mask, direction, cycleCounter, false);
+}
+
+static void _setActiveRegion(struct ARMCore* cpu, uint32_t address) {
+	struct ARMBench* bench = (struct ARMBench*) cpu->master;
+	cpu->memory.activeRegion = (uint32_t*) _region(cpu, address);
+	cpu->memory.activeMask = BENCH_MEMORY_SIZE - 1;
+	++bench->branches;
+}
+
+static void _processEvents(struct ARMCore* cpu) {
+	struct ARMBench* bench = (struct ARMBench*) cpu->master;
+	bench->cycles += cpu->cycles;
+	cpu->cycles = 0;
+	cpu->nextEvent = BENCH_CHUNK_CYCLES;
+}
+
+static void _nop(struct ARMCore* cpu) {
+	UNUSED(cpu);
+}
+
+static void _swi(struct ARMCore* cpu, int immediate) {
+	UNUSED(cpu);
+	UNUSED(immediate);
+}
+
+static void _illegal(struct ARMCore* cpu, uint32_t opcode) {
+	UNUSED(cpu);
+	UNUSED(opcode);
+}
+
+static void _benchInit(struct ARMCore* cpu, struct ARMComponent* component) {
+	struct ARMBench* bench = (struct ARMBench*) component;
+	cpu->memory.load32 = _load32;
+	cpu->memory.load16 = _load16;
+	cpu->memory.loadU16 = _loadU16;
+	cpu->memory.load8 = _load8;
+	cpu->memory.loadU8 = _loadU8;
+	cpu->memory.store32 = _store32;
+	cpu->memory.store16 = _store16;
+	cpu->memory.store8 = _store8;
+	cpu->memory.loadMultiple = _loadMultiple;
+	cpu->memory.storeMultiple = _storeMultiple;
+	cpu->memory.setActiveRegion = _setActiveRegion;
+	cpu->memory.activeSeqCycles32 = 0;
+	cpu->memory.activeSeqCycles16 = 0;
+	cpu->memory.activeNonseqCycles32 = 0;
+	cpu->memory.activeNonseqCycles16 = 0;
+	cpu->memory.activeUncachedCycles32 = 0;
+	cpu->memory.activeUncachedCycles16 = 0;
+	cpu->memory.fastCycleSet = 0;
+
+	// 与IWRAM相同：无等待周期，整个地址空间都映射到同一块内存
+	int i;
+	for (i = 0; i < ARM_FAST_REGION_COUNT; ++i) {
+		struct ARMFastRegion* region = &cpu->memory.fastRegions[i];
+		region->mask = BENCH_MEMORY_SIZE - 1;
+		region->size = BENCH_MEMORY_SIZE;
+		region->cycles[0][ARM_FAST_LOAD32_CYCLES] = 2;
+		region->cycles[0][ARM_FAST_LOAD16_CYCLES] = 2;
+		region->cycles[0][ARM_FAST_STORE32_CYCLES] = 1;
+		region->cycles[0][ARM_FAST_STORE16_CYCLES] = 1;
+		if (i == BENCH_CODE_BASE >> ARM_FAST_REGION_SHIFT) {
+			region->base = bench->code;
+			region->generations = 0;
+			region->flags = ARM_FAST_LOAD;
+		} else {
+			region->base = bench->ram;
+			region->generations = bench->generations;
+			region->flags = ARM_FAST_LOAD | ARM_FAST_STORE | ARM_FAST_STORE8;
+		}
+	}
+
+	cpu->irqh.reset = _nop;
+	cpu->irqh.processEvents = _processEvents;
+	cpu->irqh.swi16 = _swi;
+	cpu->irqh.swi32 = _swi;
+	cpu->irqh.hitIllegal = _illegal;
+	cpu->irqh.readCPSR = _nop;
+	cpu->irqh.hitStub = _illegal;
+}
+
+// 保守地排除所有可能读写PC的编码，被排除的立即数形式对测量没有影响
+static bool _acceptARM(uint32_t opcode, const struct ARMInstructionInfo* info) {
+	if (((opcode >> 16) & 0xF) == ARM_PC || ((opcode >> 12) & 0xF) == ARM_PC || ((opcode >> 8) & 0xF) == ARM_PC || (opcode & 0xF) == ARM_PC) {
+		return false;
+	}
+	if ((info->mnemonic == ARM_MN_LDM || info->mnemonic == ARM_MN_STM) && (!(opcode & 0xFFFF) || (opcode & 0x8000))) {
+		return false;
+	}
+	return true;
+}
+
+static bool _acceptThumb(uint16_t opcode, const struct ARMInstructionInfo* info) {
+	UNUSED(info);
+	if ((opcode & 0xFC00) == 0x4400) {
+		// 高寄存器操作
+		int rd = (opcode & 0x7) | ((opcode >> 4) & 0x8);
+		int rm = (opcode >> 3) & 0xF;
+		if (rd == ARM_PC || rm == ARM_PC) {
+			return false;
+		}
+	}
+	if ((opcode & 0xFF00) == 0xBD00) {
+		// POP {..., pc}
+		return false;
+	}
+	if (((opcode & 0xF000) == 0xC000 || (opcode & 0xF600) == 0xB400) && !(opcode & 0xFF)) {
+		// 空寄存器列表
+		return false;
+	}
+	return true;
+}
+
+static bool _generate(struct ARMBench* bench, enum ExecutionMode mode, enum ARMMnemonic mnemonic) {
+	struct ARMInstructionInfo info;
+	int length = 0;
+	int attempts;
+	for (attempts = 0; attempts < BENCH_MAX_ATTEMPTS && length < BENCH_STREAM_LENGTH; ++attempts) {
+		if (mode == MODE_ARM) {
+			uint32_t opcode = (_random(bench) & 0x0FFFFFFF) | (ARM_CONDITION_AL << 28);
+			ARMDecodeARM(opcode, &info);
+			if (info.mnemonic == ARM_MN_MSR) {
+				// 只写标志位，避免切换处理器模式
+				opcode = (opcode & 0xFFF0FFFF) | 0x00080000;
+				ARMDecodeARM(opcode, &info);
+			}
+			if (info.mnemonic != mnemonic || info.branchType != ARM_BRANCH_NONE || info.traps || !_acceptARM(opcode, &info)) {
+				continue;
+			}
+			STORE_32(opcode, length * WORD_SIZE_ARM, bench->code);
+		} else {
+			uint16_t opcode = _random(bench);
+			ARMDecodeThumb(opcode, &info);
+			if (info.mnemonic != mnemonic || info.branchType != ARM_BRANCH_NONE || info.traps || !_acceptThumb(opcode, &info)) {
+				continue;
+			}
+			STORE_16(opcode, length * WORD_SIZE_THUMB, bench->code);
+		}
+		++length;
+	}
+	if (length < BENCH_MIN_UNIQUE) {
+		return false;
+	}
+	int unique = length;
+	for (; length < BENCH_STREAM_LENGTH; ++length) {
+		if (mode == MODE_ARM) {
+			uint32_t opcode;
+			LOAD_32(opcode, (length % unique) * WORD_SIZE_ARM, bench->code);
+			STORE_32(opcode, length * WORD_SIZE_ARM, bench->code);
+		} else {
+			uint16_t opcode;
+			LOAD_16(opcode, (length % unique) * WORD_SIZE_THUMB, bench->code);
+			STORE_16(opcode, length * WORD_SIZE_THUMB, bench->code);
+		}
+	}
+
+	// 末尾跳回开头
+	if (mode == MODE_ARM) {
+		int32_t offset = -(BENCH_STREAM_LENGTH * WORD_SIZE_ARM + 8);
+		uint32_t opcode = 0xEA000000 | ((offset >> 2) & 0x00FFFFFF);
+		STORE_32(opcode, BENCH_STREAM_LENGTH * WORD_SIZE_ARM, bench->code);
+	} else {
+		int32_t offset = -(BENCH_STREAM_LENGTH * WORD_SIZE_THUMB + 4);
+		uint16_t opcode = 0xE000 | ((offset >> 1) & 0x07FF);
+		STORE_16(opcode, BENCH_STREAM_LENGTH * WORD_SIZE_THUMB, bench->code);
+	}
+	return true;
+}
+
+static void _reset(struct ARMCore* cpu, struct ARMBench* bench, enum ExecutionMode mode) {
+	ARMReset(cpu);
+	int i;
+	for (i = 0; i < ARM_PC; ++i) {
+		cpu->gprs[i] = _random(bench);
+	}
+	cpu->cpsr.packed = (_random(bench) & 0xF0000000) | MODE_SYSTEM;
+	if (mode == MODE_THUMB) {
+		cpu->cpsr.t = 1;
+	}
+	_ARMSetMode(cpu, mode);
+	cpu->gprs[ARM_PC] = BENCH_CODE_BASE;
+	int currentCycles = 0;
+	if (mode == MODE_THUMB) {
+		THUMB_WRITE_PC;
+	} else {
+		ARM_WRITE_PC;
+	}
+	cpu->cycles = 0;
+	cpu->nextEvent = BENCH_CHUNK_CYCLES;
+	bench->branches = 0;
+	bench->cycles = 0;
+}
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _run(struct ARMCore* cpu, struct ARMBench* bench, enum ExecutionMode mode, enum ARMMnemonic mnemonic, unsigned duration) {
+	if (!_generate(bench, mode, mnemonic)) {
+		return;
+	}
+	_reset(cpu, bench, mode);
+
+	uint64_t start = _now();
+	uint64_t elapsed;
+	do {
+		int i;
+		for (i = 0; i < BENCH_CHUNKS_PER_CHECK; ++i) {
+			ARMRunLoop(cpu);
+		}
+		elapsed = _now() - start;
+	} while (elapsed < duration * 1000ULL);
+
+	int width = mode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
+	uint64_t instructions = (uint64_t) bench->branches * (BENCH_STREAM_LENGTH + 1);
+	instructions += (cpu->gprs[ARM_PC] - width - BENCH_CODE_BASE) / width;
+	uint64_t cycles = bench->cycles + cpu->cycles;
+	printf("%s,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.3f,%.0f\n",
+	       mode == MODE_THUMB ? "thumb" : "arm", ARMMnemonicName(mnemonic), instructions, cycles, elapsed,
+	       elapsed * 1000.0 / instructions, cycles * 1000000.0 / elapsed);
+	fflush(stdout);
+}
+
+static void _usage(const char* arg0) {
+	printf("usage: %s [option ...]\n", arg0);
+	puts("\nBenchmark options:");
+	puts("  -A               Only benchmark ARM instructions");
+	puts("  -T               Only benchmark Thumb instructions");
+	puts("  -m MNEMONIC      Only benchmark the specified mnemonic class");
+	puts("  -s SEED          Seed for the generated instruction streams");
+	puts("  -t MSEC          Run each class for MSEC host milliseconds (default 200)");
+}
+
+int main(int argc, char** argv) {
+	struct BenchOpts opts = { true, true, 0, 200 };
+	static struct ARMBench bench;
+	bench.seed = 0x6D474241;
+
+	int ch;
+	errno = 0;
+	while ((ch = getopt(argc, argv, BENCH_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'A':
+			opts.thumb = false;
+			break;
+		case 'T':
+			opts.arm = false;
+			break;
+		case 'm':
+			opts.mnemonic = optarg;
+			break;
+		case 's':
+			bench.seed = strtoul(optarg, 0, 0);
+			break;
+		case 't':
+			opts.duration = strtoul(optarg, 0, 10);
+			break;
+		default:
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (errno || !bench.seed || optind != argc || (!opts.arm && !opts.thumb)) {
+		_usage(argv[0]);
+		return 1;
+	}
+
+	struct ARMCore cpu;
+	bench.d.id = 0;
+	bench.d.init = _benchInit;
+	bench.d.deinit = 0;
+	ARMSetComponents(&cpu, &bench.d, 0, 0);
+	ARMInit(&cpu);
+
+	puts("isa,mnemonic,instructions,cycles,duration,ns_per_instruction,cycles_per_second");
+	enum ARMMnemonic mnemonic;
+	for (mnemonic = ARM_MN_ILL + 1; mnemonic < ARM_MN_MAX; ++mnemonic) {
+		if (opts.mnemonic && strcmp(opts.mnemonic, ARMMnemonicName(mnemonic))) {
+			continue;
+		}
+		if (opts.arm) {
+			_run(&cpu, &bench, MODE_ARM, mnemonic, opts.duration);
+		}
+		if (opts.thumb) {
+			_run(&cpu, &bench, MODE_THUMB, mnemonic, opts.duration);
+		}
+	}
+
+	ARMDeinit(&cpu);
+	return 0;
+}
@@ -0,0 +1,258 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "gba-audio.h"
+#include "gba-resampler.h"
+#include "gba-thread.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <sys/time.h>
+
+/*
+重采样器的基准测试
+输入是合成的方波加噪声，不依赖模拟器的其余部分
+对每个质量等级反复重采样，输出CSV：每宿主秒产生的输出样本数
+-s模拟声音输出：生产者的时钟相对宿主漂移，分别在开关audioSync和速率控制时运行，缓冲区大小由GBAAudioResizeBuffer决定，消费者每次回调前调用GBAAudioControlRatio
+开启速率控制时平均比例必须抵消漂移且不能欠载，否则返回1
+*/
+
+#define BENCH_OPTIONS "i:o:q:s:t:"
+#define BENCH_CHUNK 1024
+#define BENCH_CHUNKS_PER_CHECK 64
+#define BENCH_SYNC_CALLBACKS 20000
+#define BENCH_SYNC_TOLERANCE 0.0005
+#define BENCH_SYNC_AHEAD 1.0		//只有audioSync限速时模拟器总是领先
+
+struct AudioBenchSource {
+	uint32_t seed;
+	uint32_t phase;
+	uint32_t period;
+};
+
+struct BenchOpts {
+	const char* quality;
+	unsigned inputRate;
+	unsigned outputRate;
+	unsigned duration;
+	unsigned syncSamples;
+};
+
+static unsigned _read(void* context, int32_t* left, int32_t* right, unsigned nSamples) {
+	struct AudioBenchSource* source = context;
+	unsigned i;
+	for (i = 0; i < nSamples; ++i) {
+		source->seed ^= source->seed << 13;
+		source->seed ^= source->seed >> 17;
+		source->seed ^= source->seed << 5;
+		int32_t square = source->phase < source->period / 2 ? 0x1000 : -0x1000;
+		if (++source->phase == source->period) {
+			source->phase = 0;
+		}
+		left[i] = square + (int32_t) (source->seed & 0xFF) - 0x80;
+		right[i] = -square + (int32_t) ((source->seed >> 8) & 0xFF) - 0x80;
+	}
+	return nSamples;
+}
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _run(enum GBAResamplerQuality quality, const struct BenchOpts* opts) {
+	static struct GBAResampler resampler;
+	static struct GBAStereoSample output[BENCH_CHUNK];
+	struct AudioBenchSource source = { 0x6D474241, 0, 74 };
+	GBAResamplerInit(&resampler, quality);
+	GBAResamplerSetRatio(&resampler, opts->outputRate / (float) opts->inputRate);
+
+	uint64_t samples = 0;
+	uint64_t start = _now();
+	uint64_t elapsed;
+	do {
+		int i;
+		for (i = 0; i < BENCH_CHUNKS_PER_CHECK; ++i) {
+			samples += GBAResamplerProcess(&resampler, _read, &source, output, BENCH_CHUNK);
+		}
+		elapsed = _now() - start;
+	} while (elapsed < opts->duration * 1000ULL);
+
+	printf("%s,%u,%u,%" PRIu64 ",%" PRIu64 ",%.0f\n",
+	       GBAResamplerQualityName(quality), opts->inputRate, opts->outputRate, samples, elapsed,
+	       samples * 1000000.0 / elapsed);
+	fflush(stdout);
+}
+
+static unsigned _readRing(void* context, int32_t* left, int32_t* right, unsigned nSamples) {
+	return AudioRingRead(context, left, right, nSamples);
+}
+
+/*
+生产者的时钟比宿主快或慢drift（例如模拟器按视频同步运行，而宿主声卡的时钟有偏差）
+每次回调之间生产者按漂移后的速率写入样本；audioWait时在GBASyncAudioLimit处阻塞，阻塞期间的样本不再产生，否则写满后丢弃
+开启速率控制时，后一半回调的平均比例必须抵消漂移，整个过程不能欠载或丢弃样本
+*/
+static bool _runSync(bool wait, bool rateControl, double drift, const struct BenchOpts* opts) {
+	static struct GBA gba;
+	static struct GBAResampler resampler;
+	struct GBAStereoSample* output = malloc(opts->syncSamples * sizeof(*output));
+	struct GBASync sync = {};
+	sync.audioWait = wait;
+	sync.audioRateControl = rateControl;
+	MutexInit(&sync.audioBufferMutex);
+	ConditionInit(&sync.audioRequiredCond);
+	gba.sync = &sync;
+	gba.audio.p = &gba;
+	AudioRingInit(&gba.audio.buffer, GBA_AUDIO_SAMPLES);
+	GBAAudioResizeBuffer(&gba.audio, opts->syncSamples);
+	GBAResamplerInit(&resampler, GBA_RESAMPLER_SINC);
+
+	// 与SDL相同，每次回调的输出样本数等于audioBuffers；开始时缓冲区填到限制处
+	float ratio = opts->outputRate / (float) opts->inputRate;
+	size_t limit = GBASyncAudioLimit(&sync, &gba.audio.buffer);
+	double produce = opts->syncSamples * (1 + drift) / ratio;
+	double pending = limit;
+	double fill = 0;
+	double deviation = 0;
+	unsigned underruns = 0;
+	unsigned dropped = 0;
+	int i;
+	for (i = 0; i < BENCH_SYNC_CALLBACKS; ++i) {
+		for (; pending >= 1; --pending) {
+			if (wait && AudioRingSize(&gba.audio.buffer) >= limit) {
+				pending = 0;
+				break;
+			}
+			if (!AudioRingWrite(&gba.audio.buffer, 0, 0)) {
+				++dropped;
+			}
+		}
+		pending += produce;
+		float controlled = rateControl ? GBAAudioControlRatio(&gba.audio, ratio) : ratio;
+		// 前一半回调用于让缓冲区的填充程度稳定下来
+		if (i >= BENCH_SYNC_CALLBACKS / 2) {
+			fill += AudioRingSize(&gba.audio.buffer);
+			deviation += controlled / ratio - 1;
+		}
+		GBAResamplerSetRatio(&resampler, controlled);
+		if (GBAResamplerProcess(&resampler, _readRing, &gba.audio.buffer, output, opts->syncSamples) < opts->syncSamples) {
+			++underruns;
+		}
+	}
+	size_t capacity = AudioRingCapacity(&gba.audio.buffer);
+	AudioRingDeinit(&gba.audio.buffer);
+	MutexDeinit(&sync.audioBufferMutex);
+	ConditionDeinit(&sync.audioRequiredCond);
+	free(output);
+
+	// 消耗等于生产时比例为标称值的1/(1+drift)；audioWait下生产者更快时在限制处阻塞，不需要调整
+	double expected = 1 / (1 + drift) - 1;
+	if (wait && drift > 0) {
+		expected = 0;
+	}
+	fill /= BENCH_SYNC_CALLBACKS - BENCH_SYNC_CALLBACKS / 2;
+	deviation /= BENCH_SYNC_CALLBACKS - BENCH_SYNC_CALLBACKS / 2;
+	printf("%s,%s,%+.1f%%,%u,%zu,%zu,%.0f,%.1f,%+.4f%%,%+.4f%%,%u,%u\n",
+	       wait ? "on" : "off", rateControl ? "on" : "off", drift * 100, opts->syncSamples, capacity, limit,
+	       fill, fill * 1000 / opts->inputRate, deviation * 100, expected * 100, underruns, dropped);
+	fflush(stdout);
+	return !rateControl || (fabs(deviation - expected) < BENCH_SYNC_TOLERANCE && !underruns && !dropped);
+}
+
+// 未知的名字返回GBA_RESAMPLER_QUALITY_MAX
+static enum GBAResamplerQuality _parseQuality(const char* name) {
+	enum GBAResamplerQuality quality;
+	for (quality = GBA_RESAMPLER_NEAREST; quality < GBA_RESAMPLER_QUALITY_MAX; ++quality) {
+		if (!strcmp(name, GBAResamplerQualityName(quality))) {
+			break;
+		}
+	}
+	return quality;
+}
+
+static void _usage(const char* arg0) {
+	printf("usage: %s [option ...]\n", arg0);
+	puts("\nBenchmark options:");
+	puts("  -i RATE          Input sample rate (default 32768)");
+	puts("  -o RATE          Output sample rate (default 44100)");
+	puts("  -q QUALITY       Only benchmark the specified quality (nearest, linear or sinc)");
+	puts("  -s SAMPLES       Simulate audio sync with an audio buffer of SAMPLES samples instead");
+	puts("  -t MSEC          Run each quality for MSEC host milliseconds (default 200)");
+}
+
+int main(int argc, char** argv) {
+	struct BenchOpts opts = { 0, 32768, 44100, 200, 0 };
+
+	int ch;
+	errno = 0;
+	while ((ch = getopt(argc, argv, BENCH_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'i':
+			opts.inputRate = strtoul(optarg, 0, 10);
+			break;
+		case 'o':
+			opts.outputRate = strtoul(optarg, 0, 10);
+			break;
+		case 'q':
+			opts.quality = optarg;
+			break;
+		case 's':
+			opts.syncSamples = strtoul(optarg, 0, 10);
+			if (!opts.syncSamples) {
+				_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 't':
+			opts.duration = strtoul(optarg, 0, 10);
+			break;
+		default:
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (errno || !opts.inputRate || !opts.outputRate || optind != argc) {
+		_usage(argv[0]);
+		return 1;
+	}
+	if (opts.quality && _parseQuality(opts.quality) == GBA_RESAMPLER_QUALITY_MAX) {
+		_usage(argv[0]);
+		return 1;
+	}
+
+	if (opts.syncSamples) {
+		static const double drifts[] = { -0.003, -0.001, 0.001, 0.003 };
+		puts("audio_sync,rate_control,drift,samples,capacity,limit,fill,latency_ms,ratio_deviation,expected_deviation,underruns,dropped");
+		bool passed = true;
+		int wait;
+		int rateControl;
+		size_t i;
+		for (wait = 1; wait >= 0; --wait) {
+			for (rateControl = 0; rateControl <= 1; ++rateControl) {
+				for (i = 0; i < sizeof(drifts) / sizeof(*drifts); ++i) {
+					passed = _runSync(wait, rateControl, drifts[i], &opts) && passed;
+				}
+				if (wait) {
+					passed = _runSync(wait, rateControl, BENCH_SYNC_AHEAD, &opts) && passed;
+				}
+			}
+		}
+		return !passed;
+	}
+
+	puts("quality,input_rate,output_rate,samples,duration,samples_per_second");
+	enum GBAResamplerQuality quality;
+	for (quality = GBA_RESAMPLER_NEAREST; quality < GBA_RESAMPLER_QUALITY_MAX; ++quality) {
+		if (opts.quality && strcmp(opts.quality, GBAResamplerQualityName(quality))) {
+			continue;
+		}
+		_run(quality, &opts);
+	}
+	return 0;
+}
@@ -41,6 +41,7 @@ static const struct option _options[] = {
 	{ "gdb",       no_argument, 0, 'g' },
 #endif
 	{ "patch",     required_argument, 0, 'p' },
+	{ "profile",   required_argument, 0, 'c' },
 	{ 0, 0, 0, 0 }
 };
 
@@ -49,7 +50,7 @@ bool _parseGraphicsArg(struct SubParser* parser, struct GBAConfig* config, int o
 bool parseArguments(struct GBAArguments* opts, struct GBAConfig* config, int argc, char* const* argv, struct SubParser* subparser) {
 	int ch;
 	char options[64] =
-		"b:Dl:p:s:"
+		"b:c:Dl:p:s:"
 #ifdef USE_CLI_DEBUGGER
 		"d"
 #endif
@@ -66,6 +67,9 @@ bool parseArguments(struct GBAArguments* opts, struct GBAConfig* config, int arg
 		case 'b':
 			GBAConfigSetDefaultValue(config, "bios", optarg);
 			break;
+		case 'c':
+			opts->profile = strdup(optarg);
+			break;
 		case 'D':
 			opts->dirmode = true;
 			break;
@@ -118,6 +122,9 @@ void freeArguments(struct GBAArguments* opts) {
 
 	free(opts->patch);
 	opts->patch = 0;
+
+	free(opts->profile);
+	opts->profile = 0;
 }
 
 void initParserForGraphics(struct SubParser* parser, struct GraphicsOpts* opts) {
@@ -195,6 +202,7 @@ void usage(const char* arg0, const char* extraOptions) {
 	printf("usage: %s [option ...] file\n", arg0);
 	puts("\nGeneric options:");
 	puts("  -b, --bios FILE     GBA BIOS file to use");
+	puts("  -c, --profile FILE  Write a callgrind profile of executed code to FILE on exit");
 #ifdef USE_CLI_DEBUGGER
 	puts("  -d, --debug         Use command-line debugger");
 #endif
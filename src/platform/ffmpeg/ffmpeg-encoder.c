@@ -22,7 +22,8 @@
 #include <libswscale/swscale.h>
 
 static void _ffmpegPostVideoFrame(struct GBAAVStream*, struct GBAVideoRenderer* renderer);
-static void _ffmpegPostAudioFrame(struct GBAAVStream*, int32_t left, int32_t right);
+static void _ffmpegPostAudioBuffer(struct GBAAVStream*, const struct AudioFrame* samples, size_t nSamples);
+static void _ffmpegEncodeAudio(struct FFmpegEncoder* encoder);
 
 enum {
 	PREFERRED_SAMPLE_RATE = 0x8000
@@ -32,7 +33,8 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	av_register_all();
 
 	encoder->d.postVideoFrame = _ffmpegPostVideoFrame;
-	encoder->d.postAudioFrame = _ffmpegPostAudioFrame;
+	encoder->d.postAudioFrame = 0;
+	encoder->d.postAudioBuffer = _ffmpegPostAudioBuffer;
 
 	encoder->audioCodec = 0;
 	encoder->videoCodec = 0;
@@ -349,23 +351,38 @@ bool FFmpegEncoderIsOpen(struct FFmpegEncoder* encoder) {
 	return !!encoder->context;
 }
 
-void _ffmpegPostAudioFrame(struct GBAAVStream* stream, int32_t left, int32_t right) {
+void _ffmpegPostAudioBuffer(struct GBAAVStream* stream, const struct AudioFrame* samples, size_t nSamples) {
 	struct FFmpegEncoder* encoder = (struct FFmpegEncoder*) stream;
 	if (!encoder->context || !encoder->audioCodec) {
 		return;
 	}
 
-	encoder->audioBuffer[encoder->currentAudioSample * 2] = left;
-	encoder->audioBuffer[encoder->currentAudioSample * 2 + 1] = right;
-
-	++encoder->currentAudioFrame;
-	++encoder->currentAudioSample;
-
-	if ((encoder->currentAudioSample * 4) < encoder->audioBufferSize) {
-		return;
+	size_t capacity = encoder->audioBufferSize / 4;
+	while (nSamples) {
+		size_t count = capacity - encoder->currentAudioSample;
+		if (count > nSamples) {
+			count = nSamples;
+		}
+		uint16_t* buffer = &encoder->audioBuffer[encoder->currentAudioSample * 2];
+		size_t i;
+		for (i = 0; i < count; ++i) {
+			buffer[i * 2] = samples[i].left;
+			buffer[i * 2 + 1] = samples[i].right;
+		}
+		samples += count;
+		nSamples -= count;
+		encoder->currentAudioFrame += count;
+		encoder->currentAudioSample += count;
+
+		if (encoder->currentAudioSample == capacity) {
+			encoder->currentAudioSample = 0;
+			_ffmpegEncodeAudio(encoder);
+		}
 	}
-	encoder->currentAudioSample = 0;
+}
 
+// audioBuffer攒满一块后送进重采样器，够一个编码帧时编码
+void _ffmpegEncodeAudio(struct FFmpegEncoder* encoder) {
 	int channelSize = 2 * av_get_bytes_per_sample(encoder->audio->sample_fmt);
 	avresample_convert(encoder->resampleContext,
 		0, 0, 0,
@@ -8,13 +8,14 @@
 #include "gba-video.h"
 
 static void _magickPostVideoFrame(struct GBAAVStream*, struct GBAVideoRenderer* renderer);
-static void _magickPostAudioFrame(struct GBAAVStream*, int32_t left, int32_t right);
+static void _magickPostAudioBuffer(struct GBAAVStream*, const struct AudioFrame* samples, size_t nSamples);
 
 void ImageMagickGIFEncoderInit(struct ImageMagickGIFEncoder* encoder) {
 	encoder->wand = 0;
 
 	encoder->d.postVideoFrame = _magickPostVideoFrame;
-	encoder->d.postAudioFrame = _magickPostAudioFrame;
+	encoder->d.postAudioFrame = 0;
+	encoder->d.postAudioBuffer = _magickPostAudioBuffer;
 
 	encoder->frameskip = 2;
 }
@@ -70,9 +71,9 @@ static void _magickPostVideoFrame(struct GBAAVStream* stream, struct GBAVideoRen
 	++encoder->currentFrame;
 }
 
-static void _magickPostAudioFrame(struct GBAAVStream* stream, int32_t left, int32_t right) {
+static void _magickPostAudioBuffer(struct GBAAVStream* stream, const struct AudioFrame* samples, size_t nSamples) {
 	UNUSED(stream);
-	UNUSED(left);
-	UNUSED(right);
+	UNUSED(samples);
+	UNUSED(nSamples);
 	// This is a video-only format...
 }
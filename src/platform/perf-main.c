@@ -14,34 +14,69 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <inttypes.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 
-#define PERF_OPTIONS "F:NPS:"
+#ifdef USE_JIT
+#define PERF_JIT_OPTIONS "J"
+#define PERF_JIT_USAGE "\n  -J               Translate BIOS and ROM code with the JIT"
+#else
+#define PERF_JIT_OPTIONS ""
+#define PERF_JIT_USAGE ""
+#endif
+
+#ifdef USE_PERF_COUNTERS
+#define PERF_COUNTER_OPTIONS "C:"
+#define PERF_COUNTER_USAGE "\n  -C FILE          Write the emulator's performance counters to FILE as CSV"
+#else
+#define PERF_COUNTER_OPTIONS ""
+#define PERF_COUNTER_USAGE ""
+#endif
+
+#define PERF_OPTIONS "BF:H:LMNPS:" PERF_JIT_OPTIONS PERF_COUNTER_OPTIONS
 #define PERF_USAGE \
 	"\nBenchmark options:\n" \
+	"  -B               Execute from the pre-decoded block cache\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
+	"  -H MODE          Back emulated memory with huge pages: 0 none, 1 transparent, 2 explicit\n" \
+	"  -L               Lock emulated memory and the ROM into RAM\n" \
+	"  -M               Prefault emulated memory and the ROM at startup\n" \
 	"  -N               Disable video rendering entirely\n" \
 	"  -P               CSV output, useful for parsing\n" \
-	"  -S SEC           Run for SEC in-game seconds before exiting"
+	"  -S SEC           Run for SEC in-game seconds before exiting" \
+	PERF_JIT_USAGE \
+	PERF_COUNTER_USAGE
 
 struct PerfOpts {
 	bool noVideo;
 	bool csv;
 	unsigned duration;
 	unsigned frames;
+#ifdef USE_PERF_COUNTERS
+	const char* countersFile;
+#endif
 };
 
-static void _GBAPerfRunloop(struct GBAThread* context, int* frames, bool quiet);
+static void _GBAPerfRunloop(struct GBAThread* context, int* frames, bool quiet, uint64_t* firstFrame, long* firstFrameFaults);
+static uint64_t _GBAPerfTime(void);
+static long _GBAPerfFaults(void);
 static void _GBAPerfShutdown(int signal);
 static bool _parsePerfOpts(struct SubParser* parser, struct GBAConfig* config, int option, const char* arg);
+#ifdef USE_PERF_COUNTERS
+static void _GBAPerfSaveCounters(struct GBAThread* context);
+static bool _GBAPerfWriteCounters(const char* path);
+#endif
 
 static struct GBAThread* _thread;
 static bool _dispatchExiting = false;
+#ifdef USE_PERF_COUNTERS
+static struct GBACounters _counters;
+#endif
 
 int main(int argc, char** argv) {
 	signal(SIGINT, _GBAPerfShutdown);
 
-	struct GBAVideoSoftwareRenderer renderer;
+	struct GBAVideoSoftwareRenderer renderer = {};
 	GBAVideoSoftwareRendererCreate(&renderer);
 
 	struct PerfOpts perfOpts = { false, false, 0, 0 };
@@ -83,7 +118,16 @@ int main(int argc, char** argv) {
 	opts.videoSync = false;
 	GBAMapArgumentsToContext(&args, &context);
 	GBAMapOptionsToContext(&opts, &context);
+#ifdef USE_PERF_COUNTERS
+	if (perfOpts.countersFile) {
+		// 在GBA线程销毁模拟器之前取出计数器
+		context.cleanCallback = _GBAPerfSaveCounters;
+	}
+#endif
 
+	// 启动延迟：从启动线程（载入ROM、分配内存）到第一帧，以及期间的缺页次数
+	uint64_t launch = _GBAPerfTime();
+	long launchFaults = _GBAPerfFaults();
 	GBAThreadStart(&context);
 	GBAGetGameCode(context.gba, gameCode);
 
@@ -91,13 +135,14 @@ int main(int argc, char** argv) {
 	if (!frames) {
 		frames = perfOpts.duration * 60;
 	}
-	struct timeval tv;
-	gettimeofday(&tv, 0);
-	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
-	_GBAPerfRunloop(&context, &frames, perfOpts.csv);
-	gettimeofday(&tv, 0);
-	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
+	uint64_t firstFrame = 0;
+	long firstFrameFaults = 0;
+	uint64_t start = _GBAPerfTime();
+	_GBAPerfRunloop(&context, &frames, perfOpts.csv, &firstFrame, &firstFrameFaults);
+	uint64_t end = _GBAPerfTime();
 	uint64_t duration = end - start;
+	uint64_t startup = firstFrame ? firstFrame - launch : 0;
+	long startupFaults = firstFrame ? firstFrameFaults - launchFaults : 0;
 
 	GBAThreadJoin(&context);
 	GBAConfigFreeOpts(&opts);
@@ -109,22 +154,30 @@ int main(int argc, char** argv) {
 
 	float scaledFrames = frames * 1000000.f;
 	if (perfOpts.csv) {
-		puts("game_code,frames,duration,renderer");
+		puts("game_code,frames,duration,renderer,startup,startup_faults");
 		const char* rendererName;
 		if (perfOpts.noVideo) {
 			rendererName = "none";
 		} else {
 			rendererName = "software";
 		}
-		printf("%s,%i,%" PRIu64 ",%s\n", gameCode, frames, duration, rendererName);
+		printf("%s,%i,%" PRIu64 ",%s,%" PRIu64 ",%li\n", gameCode, frames, duration, rendererName, startup, startupFaults);
 	} else {
 		printf("%u frames in %" PRIu64 " microseconds: %g fps (%gx)\n", frames, duration, scaledFrames / duration, scaledFrames / (duration * 60.f));
+		printf("%" PRIu64 " microseconds and %li page faults to the first frame\n", startup, startupFaults);
+	}
+
+#ifdef USE_PERF_COUNTERS
+	if (perfOpts.countersFile && !_GBAPerfWriteCounters(perfOpts.countersFile)) {
+		fprintf(stderr, "Could not write counters to %s\n", perfOpts.countersFile);
+		return 1;
 	}
+#endif
 
 	return 0;
 }
 
-static void _GBAPerfRunloop(struct GBAThread* context, int* frames, bool quiet) {
+static void _GBAPerfRunloop(struct GBAThread* context, int* frames, bool quiet, uint64_t* firstFrame, long* firstFrameFaults) {
 	struct timeval lastEcho;
 	gettimeofday(&lastEcho, 0);
 	int duration = *frames;
@@ -132,6 +185,10 @@ static void _GBAPerfRunloop(struct GBAThread* context, int* frames, bool quiet)
 	int lastFrames = 0;
 	while (context->state < THREAD_EXITING) {
 		if (GBASyncWaitFrameStart(&context->sync, 0)) {
+			if (!*frames) {
+				*firstFrame = _GBAPerfTime();
+				*firstFrameFaults = _GBAPerfFaults();
+			}
 			++*frames;
 			++lastFrames;
 			if (!quiet) {
@@ -162,6 +219,18 @@ static void _GBAPerfRunloop(struct GBAThread* context, int* frames, bool quiet)
 	}
 }
 
+static uint64_t _GBAPerfTime(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static long _GBAPerfFaults(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_minflt + usage.ru_majflt;
+}
+
 static void _GBAPerfShutdown(int signal) {
 	UNUSED(signal);
 	// This will come in ON the GBA thread, so we have to handle it carefully
@@ -174,9 +243,21 @@ static bool _parsePerfOpts(struct SubParser* parser, struct GBAConfig* config, i
 	struct PerfOpts* opts = parser->opts;
 	errno = 0;
 	switch (option) {
+	case 'B':
+		GBAConfigSetDefaultValue(config, "blockCache", "1");
+		return true;
 	case 'F':
 		opts->frames = strtoul(arg, 0, 10);
 		return !errno;
+	case 'H':
+		GBAConfigSetDefaultValue(config, "hugePages", arg);
+		return true;
+	case 'L':
+		GBAConfigSetDefaultValue(config, "lockMemory", "1");
+		return true;
+	case 'M':
+		GBAConfigSetDefaultValue(config, "prefaultMemory", "1");
+		return true;
 	case 'N':
 		opts->noVideo = true;
 		return true;
@@ -186,7 +267,60 @@ static bool _parsePerfOpts(struct SubParser* parser, struct GBAConfig* config, i
 	case 'S':
 		opts->duration = strtoul(arg, 0, 10);
 		return !errno;
+#ifdef USE_JIT
+	case 'J':
+		GBAConfigSetDefaultValue(config, "jit", "1");
+		return true;
+#endif
+#ifdef USE_PERF_COUNTERS
+	case 'C':
+		opts->countersFile = arg;
+		return true;
+#endif
 	default:
 		return false;
 	}
 }
+
+#ifdef USE_PERF_COUNTERS
+static void _GBAPerfSaveCounters(struct GBAThread* context) {
+	GBAGetCounters(context->gba, &_counters);
+}
+
+static bool _GBAPerfWriteCounters(const char* path) {
+	static const char* const subsystemNames[GBA_COUNTER_SUBSYSTEM_MAX] = {
+		"video", "audio", "timers", "dma", "sio"
+	};
+	static const char* const irqNames[IRQ_GAMEPAK + 1] = {
+		"vblank", "hblank", "vcounter", "timer0", "timer1", "timer2", "timer3",
+		"sio", "dma0", "dma1", "dma2", "dma3", "keypad", "gamepak"
+	};
+	FILE* out = fopen(path, "w");
+	if (!out) {
+		return false;
+	}
+	size_t i;
+	fputs("counter,key,value\n", out);
+	fprintf(out, "event_loops,,%" PRIu64 "\n", _counters.eventLoops);
+	for (i = 0; i < GBA_COUNTER_SUBSYSTEM_MAX; ++i) {
+		fprintf(out, "events,%s,%" PRIu64 "\n", subsystemNames[i], _counters.events[i]);
+	}
+	for (i = 0; i < 4; ++i) {
+		fprintf(out, "dma_units,%zu,%" PRIu64 "\n", i, _counters.dmaUnits[i]);
+	}
+	for (i = 0; i <= IRQ_GAMEPAK; ++i) {
+		fprintf(out, "irqs,%s,%" PRIu64 "\n", irqNames[i], _counters.irqs[i]);
+	}
+	fprintf(out, "halted_cycles,,%" PRIu64 "\n", _counters.haltedCycles);
+	for (i = 0; i < ARM_FAST_REGION_COUNT; ++i) {
+		fprintf(out, "memory_accesses,0x%02zX,%" PRIu64 "\n", i, _counters.memoryAccesses[i]);
+	}
+	// 大部分I/O寄存器不会被写入，只输出非零项
+	for (i = 0; i < SIZE_IO >> 1; ++i) {
+		if (_counters.ioWrites[i]) {
+			fprintf(out, "io_writes,0x%03zX,%" PRIu64 "\n", i << 1, _counters.ioWrites[i]);
+		}
+	}
+	return fclose(out) == 0;
+}
+#endif
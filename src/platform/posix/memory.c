@@ -5,12 +5,99 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "util/memory.h"
 
+#include <errno.h>
 #include <sys/mman.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE 0x200000
+
+static struct MemoryMapPolicy _policy;
+
+static void _touchPages(void* memory, size_t size, bool write);
 
 void* anonymousMemoryMap(size_t size) {
 	return mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
 }
 
+void* executableMemoryMap(size_t size) {
+	void* memory = mmap(0, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (memory == MAP_FAILED) {
+		return 0;
+	}
+	return memory;
+}
+
 void mappedMemoryFree(void* memory, size_t size) {
 	munmap(memory, size);
 }
+
+void setMemoryMapPolicy(const struct MemoryMapPolicy* policy) {
+	_policy = *policy;
+}
+
+void* residentMemoryMap(size_t size) {
+	void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (_policy.hugePages == MEMORY_HUGE_PAGES_EXPLICIT) {
+		size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+		memory = mmap(0, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (memory == MAP_FAILED) {
+		memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+		if (memory == MAP_FAILED) {
+			return memory;
+		}
+#ifdef MADV_HUGEPAGE
+		if (_policy.hugePages != MEMORY_HUGE_PAGES_NONE) {
+			madvise(memory, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+	// 在madvise之后再触发缺页，透明大页才能在第一次缺页时分配
+	if (_policy.populate) {
+		_touchPages(memory, size, true);
+	}
+	if (_policy.lock) {
+		mlock(memory, size);
+	}
+	return memory;
+}
+
+void residentMemoryFree(void* memory, size_t size) {
+	// MAP_HUGETLB的映射只能按整个大页解除
+	if (munmap(memory, size) && errno == EINVAL) {
+		munmap(memory, (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1));
+	}
+}
+
+void mappedMemoryApplyPolicy(void* memory, size_t size) {
+#ifdef MADV_HUGEPAGE
+	if (_policy.hugePages != MEMORY_HUGE_PAGES_NONE) {
+		madvise(memory, size, MADV_HUGEPAGE);
+	}
+#endif
+	// 可写的私有映射直接mlock会以写的方式触发缺页，把每一页都复制一份
+	// MLOCK_ONFAULT只锁定缺页时读入的页，再按读的方式触发缺页，页仍然与页缓存共享
+	if (_policy.lock) {
+#ifdef MLOCK_ONFAULT
+		mlock2(memory, size, MLOCK_ONFAULT);
+#endif
+		_touchPages(memory, size, false);
+	} else if (_policy.populate) {
+		_touchPages(memory, size, false);
+	}
+}
+
+static void _touchPages(void* memory, size_t size, bool write) {
+	volatile uint8_t* bytes = memory;
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t i;
+	for (i = 0; i < size; i += pageSize) {
+		if (write) {
+			bytes[i] = 0;
+		} else {
+			(void) bytes[i];
+		}
+	}
+}
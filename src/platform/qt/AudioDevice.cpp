@@ -16,9 +16,10 @@ using namespace QGBA;
 AudioDevice::AudioDevice(QObject* parent)
 	: QIODevice(parent)
 	, m_context(nullptr)
-	, m_drift(0)
+	, m_ratio(1)
 {
 	setOpenMode(ReadOnly);
+	GBAResamplerInit(&m_resampler, GBA_RESAMPLER_SINC);
 }
 
 void AudioDevice::setFormat(const QAudioFormat& format) {
@@ -26,8 +27,12 @@ void AudioDevice::setFormat(const QAudioFormat& format) {
 		return;
 	}
 	GBAThreadInterrupt(m_context);
-	m_ratio = GBAAudioCalculateRatio(&m_context->gba->audio, m_context->fpsTarget, format.sampleRate());
+	float ratio = GBAAudioCalculateRatio(&m_context->gba->audio, m_context->fpsTarget, format.sampleRate());
 	GBAThreadContinue(m_context);
+
+	QMutexLocker locker(&m_resamplerMutex);
+	m_ratio = ratio;
+	GBAResamplerSetRatio(&m_resampler, m_ratio);
 }
 
 void AudioDevice::setInput(GBAThread* input) {
@@ -43,7 +48,11 @@ qint64 AudioDevice::readData(char* data, qint64 maxSize) {
 		return 0;
 	}
 
-	return GBAAudioResampleNN(&m_context->gba->audio, m_ratio, &m_drift, reinterpret_cast<GBAStereoSample*>(data), maxSize / sizeof(GBAStereoSample)) * sizeof(GBAStereoSample);
+	QMutexLocker locker(&m_resamplerMutex);
+	if (m_context->sync.audioRateControl) {
+		GBAResamplerSetRatio(&m_resampler, GBAAudioControlRatio(&m_context->gba->audio, m_ratio));
+	}
+	return GBAAudioResample(&m_context->gba->audio, &m_resampler, reinterpret_cast<GBAStereoSample*>(data), maxSize / sizeof(GBAStereoSample)) * sizeof(GBAStereoSample);
 }
 
 qint64 AudioDevice::writeData(const char*, qint64) {
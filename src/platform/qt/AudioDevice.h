@@ -8,6 +8,11 @@
 
 #include <QAudioFormat>
 #include <QIODevice>
+#include <QMutex>
+
+extern "C" {
+#include "gba-resampler.h"
+}
 
 struct GBAThread;
 
@@ -28,7 +33,8 @@ protected:
 
 private:
 	GBAThread* m_context;
-	float m_drift;
+	QMutex m_resamplerMutex; // setFormat可能在音频线程重采样时调用
+	GBAResampler m_resampler;
 	float m_ratio;
 };
 
@@ -35,7 +35,7 @@ GameController::GameController(QObject* parent)
 	, m_turboForced(false)
 	, m_inputController(nullptr)
 {
-	m_renderer = new GBAVideoSoftwareRenderer;
+	m_renderer = new GBAVideoSoftwareRenderer();
 	GBAVideoSoftwareRendererCreate(m_renderer);
 	m_renderer->outputBuffer = (color_t*) m_drawContext;
 	m_renderer->outputBufferStride = 256;
@@ -329,6 +329,15 @@ void GameController::setAudioSync(bool set) {
 	}
 }
 
+void GameController::setAudioRateControl(bool set) {
+	threadInterrupt();
+	m_threadContext.sync.audioRateControl = set;
+	if (m_gameOpen) {
+		GBAAudioResizeBuffer(&m_threadContext.gba->audio, m_threadContext.audioBuffers);
+	}
+	threadContinue();
+}
+
 void GameController::setFrameskip(int skip) {
 	m_threadContext.frameskip = skip;
 }
@@ -351,13 +360,13 @@ void GameController::setTurbo(bool set, bool forced) {
 
 void GameController::setAVStream(GBAAVStream* stream) {
 	threadInterrupt();
-	m_threadContext.stream = stream;
+	GBAThreadSetStream(&m_threadContext, stream);
 	threadContinue();
 }
 
 void GameController::clearAVStream() {
 	threadInterrupt();
-	m_threadContext.stream = nullptr;
+	GBAThreadSetStream(&m_threadContext, nullptr);
 	threadContinue();
 }
 
@@ -87,6 +87,7 @@ public slots:
 	void saveState(int slot);
 	void setVideoSync(bool);
 	void setAudioSync(bool);
+	void setAudioRateControl(bool);
 	void setFrameskip(int);
 	void setTurbo(bool, bool forced = true);
 	void setAVStream(GBAAVStream*);
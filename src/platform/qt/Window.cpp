@@ -135,6 +135,7 @@ void Window::loadConfig() {
 
 	m_controller->setFrameskip(opts->frameskip);
 	m_controller->setAudioSync(opts->audioSync);
+	m_controller->setAudioRateControl(opts->audioRateControl);
 	m_controller->setVideoSync(opts->videoSync);
 
 	if (opts->bios) {
@@ -503,6 +504,11 @@ void Window::setupMenu(QMenuBar* menubar) {
 	audioSync->connect([this](const QVariant& value) { m_controller->setAudioSync(value.toBool()); });
 	m_config->updateOption("audioSync");
 
+	ConfigOption* audioRateControl = m_config->addOption("audioRateControl");
+	audioRateControl->addBoolean(tr("Adjust audio &rate to buffer"), emulationMenu);
+	audioRateControl->connect([this](const QVariant& value) { m_controller->setAudioRateControl(value.toBool()); });
+	m_config->updateOption("audioRateControl");
+
 	emulationMenu->addSeparator();
 	QAction* keymap = new QAction(tr("Remap keyboard..."), emulationMenu);
 	connect(keymap, SIGNAL(triggered()), this, SLOT(openKeymapWindow()));
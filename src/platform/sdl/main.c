@@ -32,7 +32,7 @@ static bool _GBASDLInit(struct SDLSoftwareRenderer* renderer);
 static void _GBASDLDeinit(struct SDLSoftwareRenderer* renderer);
 
 int main(int argc, char** argv) {
-	struct SDLSoftwareRenderer renderer;
+	struct SDLSoftwareRenderer renderer = {};
 	GBAVideoSoftwareRendererCreate(&renderer.d);
 
 	struct GBAInputMap inputMap;
@@ -24,7 +24,7 @@ bool GBASDLInitAudio(struct GBASDLAudio* context, struct GBAThread* threadContex
 	context->desiredSpec.samples = context->samples;
 	context->desiredSpec.callback = _GBASDLAudioCallback;
 	context->desiredSpec.userdata = context;
-	context->drift = 0.f;
+	GBAResamplerInit(&context->resampler, GBA_RESAMPLER_SINC);
 	if (SDL_OpenAudio(&context->desiredSpec, &context->obtainedSpec) < 0) {
 		GBALog(0, GBA_LOG_ERROR, "Could not open SDL sound system");
 		return false;
@@ -62,14 +62,18 @@ static void _GBASDLAudioCallback(void* context, Uint8* data, int len) {
 		memset(data, 0, len);
 		return;
 	}
-	audioContext->ratio = GBAAudioCalculateRatio(&audioContext->thread->gba->audio, audioContext->thread->fpsTarget, audioContext->obtainedSpec.freq);
-	if (audioContext->ratio == INFINITY) {
+	float ratio = GBAAudioCalculateRatio(&audioContext->thread->gba->audio, audioContext->thread->fpsTarget, audioContext->obtainedSpec.freq);
+	if (ratio == INFINITY) {
 		memset(data, 0, len);
 		return;
 	}
+	if (audioContext->thread->sync.audioRateControl) {
+		ratio = GBAAudioControlRatio(&audioContext->thread->gba->audio, ratio);
+	}
+	GBAResamplerSetRatio(&audioContext->resampler, ratio);
 	struct GBAStereoSample* ssamples = (struct GBAStereoSample*) data;
 	len /= 2 * audioContext->obtainedSpec.channels;
 	if (audioContext->obtainedSpec.channels == 2) {
-		GBAAudioResampleNN(&audioContext->thread->gba->audio, audioContext->ratio, &audioContext->drift, ssamples, len);
+		GBAAudioResample(&audioContext->thread->gba->audio, &audioContext->resampler, ssamples, len);
 	}
 }
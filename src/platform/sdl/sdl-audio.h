@@ -8,6 +8,8 @@
 
 #include "util/common.h"
 
+#include "gba-resampler.h"
+
 #include <SDL.h>
 
 struct GBASDLAudio {
@@ -17,8 +19,7 @@ struct GBASDLAudio {
 	// State
 	SDL_AudioSpec desiredSpec;
 	SDL_AudioSpec obtainedSpec;
-	float drift;
-	float ratio;
+	struct GBAResampler resampler;
 
 	struct GBAThread* thread;
 };
@@ -7,12 +7,45 @@
 
 #include <windows.h>
 
+static struct MemoryMapPolicy _policy;
+
 void* anonymousMemoryMap(size_t size) {
 	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 }
 
+void* executableMemoryMap(size_t size) {
+	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+}
+
 void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	// size is not useful here because we're freeing the memory, not decommitting it
 	VirtualFree(memory, 0, MEM_RELEASE);
 }
+
+// 大页需要SeLockMemoryPrivilege，这里不使用；VirtualLock会同时触发缺页
+void setMemoryMapPolicy(const struct MemoryMapPolicy* policy) {
+	_policy = *policy;
+}
+
+void* residentMemoryMap(size_t size) {
+	void* memory = anonymousMemoryMap(size);
+	if (memory) {
+		mappedMemoryApplyPolicy(memory, size);
+	}
+	return memory;
+}
+
+void residentMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+
+void mappedMemoryApplyPolicy(void* memory, size_t size) {
+	if (_policy.lock || _policy.populate) {
+		VirtualLock(memory, size);
+		if (!_policy.lock) {
+			// 只需要预先触发缺页
+			VirtualUnlock(memory, size);
+		}
+	}
+}
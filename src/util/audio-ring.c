@@ -0,0 +1,110 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "audio-ring.h"
+
+// 写入数据后以release发布下标，读取下标时以acquire保证看到对方写入的数据
+static inline size_t _loadIndex(const size_t* index) {
+	return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+static inline void _storeIndex(size_t* index, size_t value) {
+	__atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+static size_t _available(size_t readIndex, size_t writeIndex, size_t slots) {
+	if (writeIndex >= readIndex) {
+		return writeIndex - readIndex;
+	}
+	return slots - readIndex + writeIndex;
+}
+
+void AudioRingInit(struct AudioRing* ring, size_t capacity) {
+	ring->slots = capacity + 1;
+	ring->data = malloc(ring->slots * sizeof(*ring->data));
+	AudioRingClear(ring);
+}
+
+void AudioRingDeinit(struct AudioRing* ring) {
+	free(ring->data);
+	ring->data = 0;
+}
+
+void AudioRingClear(struct AudioRing* ring) {
+	_storeIndex(&ring->writeIndex, 0);
+	_storeIndex(&ring->readIndex, 0);
+}
+
+// 保留最新的帧，容量变小时丢弃最旧的帧
+void AudioRingResize(struct AudioRing* ring, size_t capacity) {
+	struct AudioFrame* data = malloc((capacity + 1) * sizeof(*data));
+	size_t size = AudioRingSize(ring);
+	size_t readIndex = ring->readIndex;
+	if (size > capacity) {
+		readIndex = (readIndex + size - capacity) % ring->slots;
+		size = capacity;
+	}
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		data[i] = ring->data[readIndex];
+		if (++readIndex == ring->slots) {
+			readIndex = 0;
+		}
+	}
+	free(ring->data);
+	ring->data = data;
+	ring->slots = capacity + 1;
+	_storeIndex(&ring->readIndex, 0);
+	_storeIndex(&ring->writeIndex, size);
+}
+
+// 在另一个线程同时读写时只是近似值
+size_t AudioRingSize(const struct AudioRing* ring) {
+	size_t readIndex = _loadIndex(&ring->readIndex);
+	return _available(readIndex, _loadIndex(&ring->writeIndex), ring->slots);
+}
+
+size_t AudioRingCapacity(const struct AudioRing* ring) {
+	return ring->slots - 1;
+}
+
+// 只能由生产者调用，缓冲区满时丢弃这一帧并返回false
+bool AudioRingWrite(struct AudioRing* ring, int32_t left, int32_t right) {
+	size_t writeIndex = ring->writeIndex;
+	size_t next = writeIndex + 1;
+	if (next == ring->slots) {
+		next = 0;
+	}
+	if (next == _loadIndex(&ring->readIndex)) {
+		return false;
+	}
+	ring->data[writeIndex].left = left;
+	ring->data[writeIndex].right = right;
+	_storeIndex(&ring->writeIndex, next);
+	return true;
+}
+
+// 只能由消费者调用，left或right为空时丢弃该声道，返回读出的帧数
+size_t AudioRingRead(struct AudioRing* ring, int32_t* left, int32_t* right, size_t frames) {
+	size_t readIndex = ring->readIndex;
+	size_t available = _available(readIndex, _loadIndex(&ring->writeIndex), ring->slots);
+	if (frames > available) {
+		frames = available;
+	}
+	size_t i;
+	for (i = 0; i < frames; ++i) {
+		if (left) {
+			left[i] = ring->data[readIndex].left;
+		}
+		if (right) {
+			right[i] = ring->data[readIndex].right;
+		}
+		if (++readIndex == ring->slots) {
+			readIndex = 0;
+		}
+	}
+	_storeIndex(&ring->readIndex, readIndex);
+	return frames;
+}
@@ -0,0 +1,44 @@
+/* Copyright (c) 2013-2014 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include "util/common.h"
+
+#define AUDIO_RING_CACHE_LINE 64
+
+struct AudioFrame {
+	int32_t left;
+	int32_t right;
+};
+
+/*
+单生产者单消费者的无锁环形缓冲区，元素是交错的左右声道样本
+生产者只写writeIndex，消费者只写readIndex，两者之间隔开一个缓存行，避免互相使对方的缓存行失效
+Init、Deinit、Clear和Resize不能与读写同时进行
+*/
+struct AudioRing {
+	struct AudioFrame* data;
+	size_t slots;			//data的帧数，比容量多一帧，用来区分满和空
+	uint8_t writerPadding[AUDIO_RING_CACHE_LINE];
+	size_t writeIndex;
+	uint8_t readerPadding[AUDIO_RING_CACHE_LINE];
+	size_t readIndex;
+	uint8_t tailPadding[AUDIO_RING_CACHE_LINE];
+};
+
+void AudioRingInit(struct AudioRing* ring, size_t capacity);
+void AudioRingDeinit(struct AudioRing* ring);
+void AudioRingClear(struct AudioRing* ring);
+void AudioRingResize(struct AudioRing* ring, size_t capacity);
+
+size_t AudioRingSize(const struct AudioRing* ring);
+size_t AudioRingCapacity(const struct AudioRing* ring);
+
+bool AudioRingWrite(struct AudioRing* ring, int32_t left, int32_t right);
+size_t AudioRingRead(struct AudioRing* ring, int32_t* left, int32_t* right, size_t frames);
+
+#endif
@@ -8,7 +8,30 @@
 
 #include "util/common.h"
 
+enum MemoryHugePages {
+	MEMORY_HUGE_PAGES_NONE = 0,
+	MEMORY_HUGE_PAGES_TRANSPARENT,	//madvise(MADV_HUGEPAGE)
+	MEMORY_HUGE_PAGES_EXPLICIT		//MAP_HUGETLB，没有预留大页时退回普通页
+};
+
+/*
+常驻内存（ROM、WRAM、IWRAM、VRAM和即时存档缓冲区）的分配策略，对整个进程有效
+populate在分配时预先触发缺页，lock用mlock锁定在物理内存中；不支持的平台忽略对应选项
+*/
+struct MemoryMapPolicy {
+	enum MemoryHugePages hugePages;
+	bool populate;
+	bool lock;
+};
+
 void* anonymousMemoryMap(size_t size);
+void* executableMemoryMap(size_t size); //失败时返回0（与VirtualAlloc一致）
 void mappedMemoryFree(void* memory, size_t size);
 
+void setMemoryMapPolicy(const struct MemoryMapPolicy* policy);
+void* residentMemoryMap(size_t size);
+void residentMemoryFree(void* memory, size_t size);
+//对已有的映射（例如ROM文件的映射）应用策略，只读取不写入，私有映射的页不会被复制；不支持按缺页锁定的平台不锁定这种映射
+void mappedMemoryApplyPolicy(void* memory, size_t size);
+
 #endif